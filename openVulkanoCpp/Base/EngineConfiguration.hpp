@@ -11,6 +11,10 @@ namespace  openVulkanoCpp
 		~EngineConfiguration() = default;
 
 		uint32_t numThreads = 1;
+		bool gpuCulling = false;
+		bool instancing = true;
+		bool pinWorkerThreads = false;
+		uint32_t occlusionQueryMinIndexCount = 0;
 
 	public:
 		static EngineConfiguration* GetEngineConfiguration()
@@ -28,5 +32,62 @@ namespace  openVulkanoCpp
 		{
 			return std::max(static_cast<uint32_t>(1), numThreads);
 		}
+
+		/**
+		 * \brief Binds every worker thread of the renderer to its own core, so the caches of its command pools stay warm between frames.
+		 * Disabled by default, it only helps if no other application is competing for the cores. It is ignored if there are not more cores than worker threads.
+		 * Must be set before the renderer gets initialized.
+		 */
+		void SetWorkerThreadPinning(bool pinWorkerThreads)
+		{
+			this->pinWorkerThreads = pinWorkerThreads;
+		}
+
+		bool IsWorkerThreadPinningEnabled() const
+		{
+			return pinWorkerThreads;
+		}
+
+		/**
+		 * \brief Moves the culling and the draw call generation to a compute shader, the renderer only issues one indirect draw per drawable.
+		 * Must be set before the renderer gets initialized.
+		 */
+		void SetGpuCulling(bool gpuCulling)
+		{
+			this->gpuCulling = gpuCulling;
+		}
+
+		bool IsGpuCullingEnabled() const
+		{
+			return gpuCulling;
+		}
+
+		/**
+		 * \brief Draws all the visible nodes of a drawable with one instanced draw instead of one draw per node.
+		 * Only used without the gpu culling, which always draws instanced. Must be set before the renderer gets initialized.
+		 */
+		void SetInstancing(bool instancing)
+		{
+			this->instancing = instancing;
+		}
+
+		bool IsInstancingEnabled() const
+		{
+			return instancing;
+		}
+
+		/**
+		 * \brief Enables the hardware occlusion queries for all drawables whose mesh has at least the given amount of indices.
+		 * 0 disables them. They are not used together with the gpu culling. Must be set before the renderer gets initialized.
+		 */
+		void SetOcclusionQueryMinIndexCount(uint32_t minIndexCount)
+		{
+			occlusionQueryMinIndexCount = minIndexCount;
+		}
+
+		uint32_t GetOcclusionQueryMinIndexCount() const
+		{
+			return occlusionQueryMinIndexCount;
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "ICloseable.hpp"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace openVulkanoCpp
+{
+	/**
+	 * \brief A pool of persistent worker threads. The threads are waiting for a task and will execute it together with the calling thread.
+	 * A worker always gets the same thread id, so per thread resources are always used by the same thread.
+	 */
+	class WorkerPool final : virtual public ICloseable
+	{
+		static constexpr uint32_t WAIT_SPIN_COUNT = 4096;
+
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable startCondition, doneCondition;
+		const std::function<void(uint32_t)>* task = nullptr;
+		std::function<void(uint32_t)> startedTask;
+		uint64_t generation = 0;
+		std::atomic<uint32_t> pending{ 0 };
+		bool running = false;
+
+	public:
+		WorkerPool() = default;
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		~WorkerPool()
+		{
+			if (running) WorkerPool::Close();
+		}
+
+		/**
+		 * \brief Starts the worker threads.
+		 * \param workerCount The amount of threads to start. The thread calling Run will be used as an additional worker.
+		 * \param pinThreads Binds worker i to core i + 1, so its caches stay warm between tasks. The calling thread is not pinned.
+		 * The workers are only pinned if there are more cores than workers, so none of them shares a core with another worker or with core 0.
+		 */
+		void Init(uint32_t workerCount, bool pinThreads = false)
+		{
+			if (running) throw std::runtime_error("The worker pool is already initialized.");
+			running = true;
+			threads.reserve(workerCount);
+			const uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+			for (uint32_t i = 0; i < workerCount; i++)
+			{
+				threads.emplace_back(&WorkerPool::WorkerMain, this, i);
+				if (pinThreads && workerCount < coreCount) PinThread(threads.back(), i + 1);
+			}
+		}
+
+		void Close() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				running = false;
+			}
+			startCondition.notify_all();
+			for (auto& thread : threads) { thread.join(); }
+			threads.clear();
+		}
+
+		/**
+		 * \brief Gets the amount of threads that will execute a task, including the calling thread.
+		 */
+		uint32_t GetThreadCount() const
+		{
+			return static_cast<uint32_t>(threads.size()) + 1;
+		}
+
+		/**
+		 * \brief Runs a task on all the workers and the calling thread. Returns once all of them have finished the task.
+		 * \param task The task to run. It will receive the id of the thread executing it, the calling thread has the id GetThreadCount() - 1.
+		 */
+		void Run(const std::function<void(uint32_t)>& task)
+		{
+			if (threads.empty())
+			{
+				task(0);
+				return;
+			}
+			Dispatch(&task);
+			task(static_cast<uint32_t>(threads.size()));
+			Wait();
+		}
+
+		/**
+		 * \brief Starts a task on the workers only and returns immediately, so the calling thread can do other work in the meantime.
+		 * Wait must be called before the next task is started.
+		 * \param task The task to run, it is copied. It will receive the ids 0 to GetThreadCount() - 2.
+		 * \return false if the pool has no workers, the task is not run at all then. The calling thread has to do all the work itself.
+		 */
+		bool Start(const std::function<void(uint32_t)>& task)
+		{
+			if (threads.empty()) return false;
+			startedTask = task;
+			Dispatch(&startedTask);
+			return true;
+		}
+
+		/**
+		 * \brief Waits until all the workers have finished the current task. Returns immediately if no task is running.
+		 */
+		void Wait()
+		{
+			// The workers usually finish close to the calling thread, so a short spin avoids going to sleep
+			for (uint32_t i = 0; i < WAIT_SPIN_COUNT && pending.load(std::memory_order_acquire) != 0; i++)
+			{
+				std::this_thread::yield();
+			}
+			if (pending.load(std::memory_order_acquire) != 0)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				doneCondition.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+			}
+			task = nullptr;
+		}
+
+		/**
+		 * \brief Splits a range into one continuous chunk per thread and processes them in parallel. Returns once the whole range is processed.
+		 * \param count The size of the range
+		 * \param func The function that processes a chunk [begin, end)
+		 * \param minChunkSize The minimal amount of elements a thread should process. Small ranges will be processed by the calling thread only.
+		 */
+		void ParallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t minChunkSize = 1)
+		{
+			if (count == 0) return;
+			const size_t threadCount = std::min<size_t>(GetThreadCount(), std::max<size_t>(1, count / std::max<size_t>(1, minChunkSize)));
+			if (threadCount == 1)
+			{
+				func(0, count);
+				return;
+			}
+			const size_t chunkSize = (count + threadCount - 1) / threadCount;
+			Run([&](uint32_t threadId)
+			{
+				const size_t begin = threadId * chunkSize;
+				const size_t end = std::min(count, begin + chunkSize);
+				if (begin < end) func(begin, end);
+			});
+		}
+
+	private:
+		void Dispatch(const std::function<void(uint32_t)>* task)
+		{
+			if (pending.load(std::memory_order_acquire) != 0) throw std::logic_error("The previous task of the worker pool is still running.");
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				this->task = task;
+				pending.store(static_cast<uint32_t>(threads.size()), std::memory_order_relaxed);
+				generation++;
+			}
+			startCondition.notify_all();
+		}
+
+		static void PinThread(std::thread& thread, uint32_t core)
+		{
+#ifdef _WIN32
+			if (core < 64) SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << core);
+#elif defined(__linux__)
+			cpu_set_t cpuSet;
+			CPU_ZERO(&cpuSet);
+			CPU_SET(core, &cpuSet);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+#else
+			(void)thread; (void)core; // No affinity api, the scheduler decides
+#endif
+		}
+
+		void WorkerMain(uint32_t id)
+		{
+			uint64_t lastGeneration = 0;
+			while (true)
+			{
+				const std::function<void(uint32_t)>* currentTask;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					startCondition.wait(lock, [&] { return !running || generation != lastGeneration; });
+					if (!running) return;
+					lastGeneration = generation;
+					currentTask = task;
+				}
+				(*currentTask)(id);
+				if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{ // The lock makes sure a waiting thread can't miss the notification between checking pending and going to sleep
+					std::lock_guard<std::mutex> lock(mutex);
+					doneCondition.notify_one();
+				}
+			}
+		}
+	};
+}
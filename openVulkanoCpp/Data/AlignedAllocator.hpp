@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace openVulkanoCpp
+{
+	namespace Data
+	{
+		/**
+		 * \brief An allocator that can be used with the std containers to get memory with a custom alignment (e.g. cache line aligned).
+		 * \tparam T The type of the elements that should be allocated
+		 * \tparam ALIGNMENT The alignment in bytes, must be a power of two and a multiple of sizeof(void*)
+		 */
+		template <typename T, size_t ALIGNMENT = 64>
+		class AlignedAllocator
+		{
+			static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0, "The alignment must be a power of two");
+			static_assert(ALIGNMENT % sizeof(void*) == 0, "The alignment must be a multiple of the pointer size");
+
+		public:
+			typedef T value_type;
+
+			template <typename U>
+			struct rebind
+			{
+				typedef AlignedAllocator<U, ALIGNMENT> other;
+			};
+
+			AlignedAllocator() noexcept = default;
+
+			template <typename U>
+			AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) noexcept {}
+
+			T* allocate(size_t count)
+			{
+				if (count == 0) return nullptr;
+				void* memory = nullptr;
+#ifdef _WIN32
+				memory = _aligned_malloc(count * sizeof(T), ALIGNMENT);
+#else
+				if (posix_memalign(&memory, ALIGNMENT, count * sizeof(T))) memory = nullptr;
+#endif
+				if (!memory) throw std::bad_alloc();
+				return static_cast<T*>(memory);
+			}
+
+			void deallocate(T* pointer, size_t) noexcept
+			{
+#ifdef _WIN32
+				_aligned_free(pointer);
+#else
+				free(pointer);
+#endif
+			}
+
+			template <typename U>
+			bool operator==(const AlignedAllocator<U, ALIGNMENT>&) const noexcept { return true; }
+
+			template <typename U>
+			bool operator!=(const AlignedAllocator<U, ALIGNMENT>&) const noexcept { return false; }
+		};
+	}
+}
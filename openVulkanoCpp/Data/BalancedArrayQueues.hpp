@@ -0,0 +1,126 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <cstdint>
+#include "ReadOnlyAtomicArrayQueue.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Data
+	{
+		/**
+		 * \brief Splits an array into one continuous range per consumer, so that every consumer gets about the same amount of work.
+		 * The work of an element is estimated with a cost function and weighted with the rate (cost per second) every consumer reached
+		 * on its own range in the previous frames. A consumer that finishes its own range early steals chunks from the ranges of the others.
+		 */
+		template <class T>
+		class BalancedArrayQueues final
+		{
+			static constexpr double RATE_SMOOTHING = 0.25;
+			static constexpr double MIN_RELATIVE_RATE = 0.1; // Every consumer keeps a range to be measured on, so a slow frame can't starve it forever
+
+			std::unique_ptr<ReadOnlyAtomicArrayQueue<T>[]> queues;
+			std::vector<double> rates, costPrefix;
+			std::vector<double> ownCosts; // The cost popped by the owner of a range, only written by the owner
+			T* data = nullptr;
+			uint32_t consumerCount = 0;
+
+		public:
+			void Init(uint32_t consumerCount)
+			{
+				this->consumerCount = std::max(1u, consumerCount);
+				queues.reset(new ReadOnlyAtomicArrayQueue<T>[this->consumerCount]);
+				rates.assign(this->consumerCount, 0);
+				ownCosts.assign(this->consumerCount, 0);
+			}
+
+			uint32_t GetConsumerCount() const
+			{
+				return consumerCount;
+			}
+
+			/**
+			 * \brief Gets the amount of elements left in the range of a consumer.
+			 */
+			size_t GetRemaining(uint32_t consumer) const
+			{
+				return queues[consumer].GetSize();
+			}
+
+			/**
+			 * \brief Splits an array between the consumers. Must not be called while the consumers are popping.
+			 * \param cost Function returning the estimated cost (double) of the element with the given index
+			 */
+			template <class CostFunction>
+			void Partition(T* data, size_t count, const CostFunction& cost)
+			{
+				costPrefix.resize(count + 1);
+				costPrefix[0] = 0;
+				for (size_t i = 0; i < count; i++) costPrefix[i + 1] = costPrefix[i] + cost(i);
+				this->data = data;
+				// Consumers without a measured rate yet get the mean rate of the others, without any measurement the work is split evenly
+				const size_t measuredCount = std::count_if(rates.begin(), rates.end(), [](double rate) { return rate > 0; });
+				const double defaultRate = measuredCount ? std::accumulate(rates.begin(), rates.end(), 0.0) / measuredCount : 1;
+				const auto getRate = [&](uint32_t consumer) { return rates[consumer] > 0 ? std::max(rates[consumer], defaultRate * MIN_RELATIVE_RATE) : defaultRate; };
+				double totalRate = 0;
+				for (uint32_t i = 0; i < consumerCount; i++) totalRate += getRate(i);
+				double rateSum = 0;
+				size_t begin = 0;
+				for (uint32_t i = 0; i < consumerCount; i++)
+				{
+					rateSum += getRate(i);
+					size_t end = count;
+					if (i + 1 < consumerCount)
+					{
+						const double targetCost = costPrefix[count] * rateSum / totalRate;
+						end = std::lower_bound(costPrefix.begin() + begin, costPrefix.end(), targetCost) - costPrefix.begin();
+						end = std::min(count, end);
+					}
+					queues[i].Reset(data + begin, end - begin);
+					ownCosts[i] = 0;
+					begin = end;
+				}
+			}
+
+			/**
+			 * \brief Pops a continuous chunk from the range of a consumer. Once it is empty the chunks are stolen from the ranges of the other consumers.
+			 * \param count Receives the amount of elements that have been popped
+			 * \param stolen Is set to true if the chunk has been stolen, the own range of the consumer is empty then
+			 * \return The first popped element, nullptr if all the ranges are empty
+			 */
+			T* Pop(uint32_t consumer, size_t& count, size_t minChunkSize, bool& stolen)
+			{
+				for (uint32_t i = 0; i < consumerCount; i++)
+				{
+					// The owner takes half of its range at once, thieves take half of what is left, so the owner isn't robbed of everything
+					T* first = queues[(consumer + i) % consumerCount].PopChunk(1, count, minChunkSize);
+					if (!first) continue;
+					stolen = i != 0;
+					if (!stolen)
+					{
+						const size_t index = first - data;
+						ownCosts[consumer] += costPrefix[index + count] - costPrefix[index];
+					}
+					return first;
+				}
+				stolen = false;
+				return nullptr;
+			}
+
+			/**
+			 * \brief Reports the time a consumer needed to empty its own range, the rate is used by the next partition.
+			 * Only the cost the consumer popped itself counts, so a consumer that starts late and gets robbed by the others reports a low rate.
+			 * Every consumer may report its own rate from its own thread.
+			 * \param seconds The time from the common start until the own range was empty (the first steal)
+			 */
+			void Report(uint32_t consumer, double seconds)
+			{
+				if (seconds <= 0 || ownCosts[consumer] <= 0) return;
+				const double rate = ownCosts[consumer] / seconds;
+				rates[consumer] = rates[consumer] > 0 ? rates[consumer] * (1 - RATE_SMOOTHING) + rate * RATE_SMOOTHING : rate;
+			}
+		};
+	}
+}
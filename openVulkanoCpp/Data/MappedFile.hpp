@@ -0,0 +1,123 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "../Base/ICloseable.hpp"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace openVulkanoCpp
+{
+	namespace Data
+	{
+		/**
+		 * \brief Maps a whole file read only into memory. The pages are loaded by the os when they are accessed for the first time.
+		 */
+		class MappedFile final : public ICloseable
+		{
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+#ifdef _WIN32
+			HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+		public:
+			MappedFile() = default;
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			explicit MappedFile(const std::string& path)
+			{
+				Open(path);
+			}
+
+			~MappedFile() override
+			{
+				if (data) MappedFile::Close();
+			}
+
+			/**
+			 * \brief Maps a file, throws if the file can't be opened or is empty.
+			 */
+			void Open(const std::string& path)
+			{
+				if (data) throw std::runtime_error("The mapped file is already open!");
+#ifdef _WIN32
+				file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				LARGE_INTEGER fileSize;
+				if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return Fail(path);
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (!mapping) return Fail(path);
+				data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if (!data) return Fail(path);
+				size = static_cast<size_t>(fileSize.QuadPart);
+#else
+				const int file = open(path.c_str(), O_RDONLY);
+				if (file < 0) throw std::runtime_error("Failed to open file: " + path);
+				struct stat status;
+				void* memory = MAP_FAILED;
+				if (fstat(file, &status) == 0 && status.st_size > 0)
+				{
+					memory = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+				}
+				close(file); // The mapping keeps the file alive
+				if (memory == MAP_FAILED) throw std::runtime_error("Failed to map file: " + path);
+				data = static_cast<const uint8_t*>(memory);
+				size = static_cast<size_t>(status.st_size);
+#endif
+			}
+
+			void Close() override
+			{
+#ifdef _WIN32
+				if (data) UnmapViewOfFile(data);
+				if (mapping) CloseHandle(mapping);
+				if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+				mapping = nullptr;
+				file = INVALID_HANDLE_VALUE;
+#else
+				if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+				data = nullptr;
+				size = 0;
+			}
+
+			bool IsOpen() const
+			{
+				return data != nullptr;
+			}
+
+			const uint8_t* GetData() const
+			{
+				return data;
+			}
+
+			size_t GetSize() const
+			{
+				return size;
+			}
+
+		private:
+#ifdef _WIN32
+			void Fail(const std::string& path)
+			{
+				Close();
+				throw std::runtime_error("Failed to map file: " + path);
+			}
+#endif
+		};
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <vector>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <cassert>
+
+namespace openVulkanoCpp
+{
+	namespace Data
+	{
+		/**
+		 * \brief A typed pool allocator. The objects are stored in continuous chunks, freed slots are reused through a free list.
+		 * All the objects can be released at once with Clear. The pool is not thread safe.
+		 * \tparam T The type of the objects
+		 * \tparam CHUNK_SIZE The amount of objects per chunk
+		 */
+		template <class T, size_t CHUNK_SIZE = 1024>
+		class ObjectPool final
+		{
+			struct Slot
+			{
+				alignas(T) unsigned char storage[sizeof(T)];
+				Slot* nextFree;
+				bool alive;
+			};
+
+			std::vector<Slot*> chunks;
+			Slot* freeList = nullptr;
+			size_t bumpIndex = 0, size = 0; // bumpIndex is the amount of slots that have been handed out from the chunks in order
+
+		public:
+			ObjectPool() = default;
+			ObjectPool(const ObjectPool&) = delete;
+			ObjectPool& operator=(const ObjectPool&) = delete;
+
+			~ObjectPool()
+			{
+				Clear();
+			}
+
+			/**
+			 * \brief Constructs a new object inside the pool.
+			 * \param args The arguments for the constructor of the object
+			 * \return The new object. It must only be released through Destroy or Clear of this pool.
+			 */
+			template <typename... Args>
+			T* Create(Args&&... args)
+			{
+				Slot* slot = AllocateSlot();
+				T* object = new(slot->storage) T(std::forward<Args>(args)...);
+				slot->alive = true;
+				size++;
+				return object;
+			}
+
+			/**
+			 * \brief Destructs an object and returns its slot to the pool.
+			 * \param object The object to release, it must have been created by this pool.
+			 */
+			void Destroy(T* object)
+			{
+				if (!object) return;
+				assert(Owns(object) && "The object has not been created by this pool");
+				Slot* slot = reinterpret_cast<Slot*>(object);
+				if (!slot->alive) return;
+				object->~T();
+				slot->alive = false;
+				slot->nextFree = freeList;
+				freeList = slot;
+				size--;
+			}
+
+			/**
+			 * \brief Destructs all the objects of the pool and frees its memory.
+			 */
+			void Clear()
+			{
+				for (Slot* chunk : chunks)
+				{
+					for (size_t i = 0; i < CHUNK_SIZE; i++)
+					{
+						if (chunk[i].alive) reinterpret_cast<T*>(chunk[i].storage)->~T();
+					}
+					::operator delete(chunk);
+				}
+				chunks.clear();
+				freeList = nullptr;
+				bumpIndex = 0;
+				size = 0;
+			}
+
+			/**
+			 * \brief Allocates enough chunks to hold the given amount of objects without further allocations.
+			 */
+			void Reserve(size_t count)
+			{
+				while (chunks.size() * CHUNK_SIZE < count) AllocateChunk();
+			}
+
+			size_t GetSize() const
+			{
+				return size;
+			}
+
+			/**
+			 * \brief Checks if an object lives in one of the slots of this pool. It has to check every chunk, so it is meant for debugging.
+			 */
+			bool Owns(const T* object) const
+			{
+				const unsigned char* address = reinterpret_cast<const unsigned char*>(object);
+				for (const Slot* chunk : chunks)
+				{
+					const unsigned char* begin = reinterpret_cast<const unsigned char*>(chunk);
+					if (address >= begin && address < begin + sizeof(Slot) * CHUNK_SIZE) return (address - begin) % sizeof(Slot) == 0;
+				}
+				return false;
+			}
+
+		private:
+			void AllocateChunk()
+			{
+				Slot* chunk = static_cast<Slot*>(::operator new(sizeof(Slot) * CHUNK_SIZE));
+				for (size_t i = 0; i < CHUNK_SIZE; i++) chunk[i].alive = false;
+				chunks.push_back(chunk);
+			}
+
+			Slot* AllocateSlot()
+			{
+				if (freeList)
+				{
+					Slot* slot = freeList;
+					freeList = slot->nextFree;
+					return slot;
+				}
+				if (bumpIndex == chunks.size() * CHUNK_SIZE) AllocateChunk();
+				Slot* slot = &chunks[bumpIndex / CHUNK_SIZE][bumpIndex % CHUNK_SIZE];
+				bumpIndex++;
+				return slot;
+			}
+		};
+	}
+}
@@ -1,44 +1,87 @@
 #pragma once
 #include <atomic>
 #include <vector>
+#include <algorithm>
+#include <cstddef>
 
 namespace openVulkanoCpp
 {
 	namespace Data
 	{
+		/**
+		 * \brief Hands out the elements of an array to multiple consumers, front to back. Every pop is a single atomic add on a shared counter.
+		 */
 		template <class T>
 		class ReadOnlyAtomicArrayQueue final
 		{
 			T* data;
-			std::atomic<size_t> size;
+			size_t size;
+			std::atomic<size_t> head;
 
 		public:
-			ReadOnlyAtomicArrayQueue(std::vector<T>& data)
-			{
-				this->data = data.data();
-				size.store(data.size());
-			}
+			ReadOnlyAtomicArrayQueue() : ReadOnlyAtomicArrayQueue(nullptr, 0)
+			{}
+
+			ReadOnlyAtomicArrayQueue(std::vector<T>& data) : ReadOnlyAtomicArrayQueue(data.data(), data.size())
+			{}
+
+			ReadOnlyAtomicArrayQueue(T* data, size_t size) : data(data), size(size), head(0)
+			{}
 
-			ReadOnlyAtomicArrayQueue(T* data, size_t size)
+			~ReadOnlyAtomicArrayQueue() = default;
+
+			/**
+			 * \brief Replaces the elements of the queue. Must not be called while other threads are popping.
+			 */
+			void Reset(T* data, size_t size)
 			{
 				this->data = data;
-				this->size.store(size);
+				this->size = size;
+				head.store(0, std::memory_order_relaxed);
 			}
 
-			~ReadOnlyAtomicArrayQueue() = default;
-
+			/**
+			 * \brief Gets the amount of elements that have not been popped yet.
+			 */
 			size_t GetSize() const
 			{
-				return size.load(std::memory_order_relaxed);
+				return size - std::min(size, head.load(std::memory_order_relaxed));
 			}
 
 			T* Pop()
 			{
-				size_t s = size.load(std::memory_order_relaxed);
-				while (size > 0 && !size.compare_exchange_weak(s, s - 1));
-				if (s > 0) return &data[s - 1];
-				return nullptr;
+				size_t count;
+				return PopRange(1, count);
+			}
+
+			/**
+			 * \brief Pops up to maxCount continuous elements.
+			 * \param count Receives the amount of elements that have been popped
+			 * \return The first popped element, nullptr if the queue is empty
+			 */
+			T* PopRange(size_t maxCount, size_t& count)
+			{
+				count = 0;
+				if (maxCount == 0 || head.load(std::memory_order_relaxed) >= size) return nullptr; // Don't keep counting up once empty
+				const size_t first = head.fetch_add(maxCount, std::memory_order_relaxed);
+				if (first >= size) return nullptr;
+				count = std::min(maxCount, size - first);
+				return &data[first];
+			}
+
+			/**
+			 * \brief Pops a chunk whose size shrinks with the remaining elements (guided scheduling). The consumers start with big continuous chunks
+			 * and the small chunks towards the end keep them finishing at about the same time.
+			 * \param consumerCount The amount of threads popping from the queue
+			 * \param count Receives the amount of elements that have been popped
+			 * \param minChunkSize The smallest chunk that will be popped, unless less elements are left
+			 * \return The first popped element, nullptr if the queue is empty
+			 */
+			T* PopChunk(size_t consumerCount, size_t& count, size_t minChunkSize = 1)
+			{
+				const size_t remaining = GetSize();
+				return PopRange(std::max(std::max<size_t>(1, minChunkSize), remaining / (2 * std::max<size_t>(1, consumerCount))), count);
 			}
 		};
 	}
-}
\ No newline at end of file
+}
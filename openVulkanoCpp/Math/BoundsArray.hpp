@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Data/AlignedAllocator.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Math
+	{
+		/**
+		 * \brief Stores axis aligned boxes as center and half extent in separate float arrays (structure of arrays),
+		 * so multiple boxes can be processed at once with simd instructions.
+		 */
+		class BoundsArray final
+		{
+		public:
+			typedef std::vector<float, Data::AlignedAllocator<float, 64>> FloatArray;
+
+			FloatArray centerX, centerY, centerZ, extentX, extentY, extentZ;
+
+			size_t Size() const
+			{
+				return centerX.size();
+			}
+
+			void Reserve(size_t size)
+			{
+				centerX.reserve(size); centerY.reserve(size); centerZ.reserve(size);
+				extentX.reserve(size); extentY.reserve(size); extentZ.reserve(size);
+			}
+
+			void Resize(size_t size)
+			{
+				centerX.resize(size); centerY.resize(size); centerZ.resize(size);
+				extentX.resize(size); extentY.resize(size); extentZ.resize(size);
+			}
+
+			void PushBack(const glm::vec3& center, const glm::vec3& extent)
+			{
+				centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+				extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+			}
+
+			void Set(size_t index, const glm::vec3& center, const glm::vec3& extent)
+			{
+				centerX[index] = center.x; centerY[index] = center.y; centerZ[index] = center.z;
+				extentX[index] = extent.x; extentY[index] = extent.y; extentZ[index] = extent.z;
+			}
+
+			glm::vec3 GetCenter(size_t index) const
+			{
+				return glm::vec3(centerX[index], centerY[index], centerZ[index]);
+			}
+
+			glm::vec3 GetExtent(size_t index) const
+			{
+				return glm::vec3(extentX[index], extentY[index], extentZ[index]);
+			}
+
+			/**
+			 * \brief Transforms a box and calculates the axis aligned box that encloses the result.
+			 */
+			static void Transform(const glm::mat4x4& mat, const glm::vec3& center, const glm::vec3& extent, glm::vec3& outCenter, glm::vec3& outExtent)
+			{
+				outCenter = glm::vec3(mat[0]) * center.x + glm::vec3(mat[1]) * center.y + glm::vec3(mat[2]) * center.z + glm::vec3(mat[3]);
+				outExtent = glm::abs(glm::vec3(mat[0])) * extent.x + glm::abs(glm::vec3(mat[1])) * extent.y + glm::abs(glm::vec3(mat[2])) * extent.z;
+			}
+		};
+	}
+}
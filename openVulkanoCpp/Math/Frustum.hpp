@@ -0,0 +1,230 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "MatrixBatch.hpp"
+#include "BoundsArray.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Math
+	{
+		/**
+		 * \brief The six planes of a view frustum. The normals of the planes are pointing to the inside of the frustum.
+		 * The simd kernel used for culling is selected at runtime the same way as the one of the MatrixBatch.
+		 * Optionally boxes whose bounding sphere covers less than a minimum amount of pixels on screen are culled as well (contribution culling).
+		 */
+		class Frustum
+		{
+			glm::vec4 planes[6];
+			// A box contributes if |extent|^2 * contributionOrigin.w >= |center - contributionOrigin.xyz|^2 * contributionDistance.x + contributionDistance.y
+			glm::vec4 contributionOrigin = glm::vec4(0); // w = 0 disables the contribution culling
+			glm::vec2 contributionDistance = glm::vec2(1, 0);
+
+		public:
+			Frustum() = default;
+
+			explicit Frustum(const glm::mat4x4& viewProjection)
+			{
+				Init(viewProjection);
+			}
+
+			/**
+			 * \brief Extracts the planes from a view projection matrix with a depth range of [0, 1].
+			 */
+			void Init(const glm::mat4x4& viewProjection)
+			{
+				const glm::vec4 row0 = Row(viewProjection, 0), row1 = Row(viewProjection, 1);
+				const glm::vec4 row2 = Row(viewProjection, 2), row3 = Row(viewProjection, 3);
+				planes[0] = row3 + row0; // left
+				planes[1] = row3 - row0; // right
+				planes[2] = row3 + row1; // bottom
+				planes[3] = row3 - row1; // top
+				planes[4] = row2; // near
+				planes[5] = row3 - row2; // far
+				for (glm::vec4& plane : planes)
+				{
+					plane = plane / glm::length(glm::vec3(plane));
+				}
+			}
+
+			const glm::vec4& GetPlane(int index) const
+			{
+				return planes[index];
+			}
+
+			/**
+			 * \brief Enables the contribution culling, the planes are not changed.
+			 * \param projection The projection matrix of the camera, perspective or orthographic
+			 * \param cameraPosition The world space position of the camera
+			 * \param viewportHeight The height of the viewport in pixels
+			 * \param minPixelSize The minimum diameter of the projected bounding sphere of a box in pixels, 0 disables the contribution culling
+			 */
+			void SetContributionCulling(const glm::mat4x4& projection, const glm::vec3& cameraPosition, float viewportHeight, float minPixelSize)
+			{
+				if (minPixelSize <= 0 || viewportHeight <= 0)
+				{
+					contributionOrigin = glm::vec4(0);
+					return;
+				}
+				// The projected diameter in pixels is radius * |P[1][1]| * viewportHeight, divided by the distance for perspective projections
+				const float scale = std::abs(projection[1][1]) * viewportHeight / minPixelSize;
+				contributionOrigin = glm::vec4(cameraPosition, scale * scale);
+				contributionDistance = (projection[3][3] == 0) ? glm::vec2(1, 0) : glm::vec2(0, 1);
+			}
+
+			bool IsContributionCullingEnabled() const
+			{
+				return contributionOrigin.w > 0;
+			}
+
+			/**
+			 * \brief Gets the camera position (xyz) and the squared scale of the bounding sphere radius (w) of the contribution culling.
+			 */
+			const glm::vec4& GetContributionOrigin() const
+			{
+				return contributionOrigin;
+			}
+
+			/**
+			 * \brief Gets the scale (x) and the bias (y) that are applied to the squared distance of a box by the contribution culling.
+			 */
+			const glm::vec2& GetContributionDistance() const
+			{
+				return contributionDistance;
+			}
+
+			/**
+			 * \brief Checks if a box is at least partially inside of the frustum. Boxes close to the corners of the frustum might be reported as visible.
+			 */
+			bool IsVisible(const glm::vec3& center, const glm::vec3& extent) const
+			{
+				for (const glm::vec4& plane : planes)
+				{
+					const glm::vec3 normal = glm::vec3(plane);
+					if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extent) + plane.w < 0) return false;
+				}
+				return true;
+			}
+
+			/**
+			 * \brief Checks if the bounding sphere of a box is large enough on screen, always true without contribution culling.
+			 */
+			bool IsContributing(const glm::vec3& center, const glm::vec3& extent) const
+			{
+				if (contributionOrigin.w <= 0) return true;
+				const glm::vec3 offset = center - glm::vec3(contributionOrigin);
+				return glm::dot(extent, extent) * contributionOrigin.w >= glm::dot(offset, offset) * contributionDistance.x + contributionDistance.y;
+			}
+
+			/**
+			 * \brief Checks a range of boxes against the frustum and, if enabled, the minimum contribution.
+			 * \param bounds The boxes to check
+			 * \param begin The index of the first box
+			 * \param end The index after the last box
+			 * \param visible Receives 1 for every visible box and 0 for every culled box, indexed like the bounds
+			 */
+			void Cull(const BoundsArray& bounds, size_t begin, size_t end, uint8_t* visible) const
+			{
+				switch (MatrixBatch::GetKernel())
+				{
+#ifdef OPENVULKANO_X86
+					case MatrixBatch::Kernel::AVX2: begin = CullAvx2(bounds, begin, end, visible); break;
+					case MatrixBatch::Kernel::SSE: begin = CullSse(bounds, begin, end, visible); break;
+#endif
+					default: break;
+				}
+				for (; begin < end; begin++)
+				{
+					const glm::vec3 center = bounds.GetCenter(begin), extent = bounds.GetExtent(begin);
+					visible[begin] = (IsVisible(center, extent) && IsContributing(center, extent)) ? 1 : 0;
+				}
+			}
+
+		private:
+			static glm::vec4 Row(const glm::mat4x4& mat, int row)
+			{
+				return glm::vec4(mat[0][row], mat[1][row], mat[2][row], mat[3][row]);
+			}
+
+#ifdef OPENVULKANO_X86
+			/**
+			 * \return The index of the first box that has not been processed
+			 */
+			size_t CullSse(const BoundsArray& bounds, size_t begin, size_t end, uint8_t* visible) const
+			{
+				const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)), zero = _mm_setzero_ps();
+				const bool contribution = contributionOrigin.w > 0;
+				const __m128 ox = _mm_set1_ps(contributionOrigin.x), oy = _mm_set1_ps(contributionOrigin.y), oz = _mm_set1_ps(contributionOrigin.z);
+				const __m128 radiusScale = _mm_set1_ps(contributionOrigin.w);
+				const __m128 distanceScale = _mm_set1_ps(contributionDistance.x), distanceBias = _mm_set1_ps(contributionDistance.y);
+				for (; begin + 4 <= end; begin += 4)
+				{
+					const __m128 cx = _mm_loadu_ps(&bounds.centerX[begin]), cy = _mm_loadu_ps(&bounds.centerY[begin]), cz = _mm_loadu_ps(&bounds.centerZ[begin]);
+					const __m128 ex = _mm_loadu_ps(&bounds.extentX[begin]), ey = _mm_loadu_ps(&bounds.extentY[begin]), ez = _mm_loadu_ps(&bounds.extentZ[begin]);
+					__m128 inside = _mm_cmpeq_ps(zero, zero);
+					for (const glm::vec4& plane : planes)
+					{
+						const __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+						__m128 distance = _mm_add_ps(_mm_set1_ps(plane.w), _mm_mul_ps(nx, cx));
+						distance = _mm_add_ps(distance, _mm_mul_ps(ny, cy));
+						distance = _mm_add_ps(distance, _mm_mul_ps(nz, cz));
+						distance = _mm_add_ps(distance, _mm_mul_ps(_mm_and_ps(nx, absMask), ex));
+						distance = _mm_add_ps(distance, _mm_mul_ps(_mm_and_ps(ny, absMask), ey));
+						distance = _mm_add_ps(distance, _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+					}
+					if (contribution)
+					{
+						const __m128 squaredRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+						const __m128 dx = _mm_sub_ps(cx, ox), dy = _mm_sub_ps(cy, oy), dz = _mm_sub_ps(cz, oz);
+						const __m128 squaredDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+						const __m128 required = _mm_add_ps(_mm_mul_ps(squaredDistance, distanceScale), distanceBias);
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_mul_ps(squaredRadius, radiusScale), required));
+					}
+					const int mask = _mm_movemask_ps(inside);
+					for (int i = 0; i < 4; i++) visible[begin + i] = (mask >> i) & 1;
+				}
+				return begin;
+			}
+
+			OPENVULKANO_TARGET_AVX2 size_t CullAvx2(const BoundsArray& bounds, size_t begin, size_t end, uint8_t* visible) const
+			{
+				const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)), zero = _mm256_setzero_ps();
+				const bool contribution = contributionOrigin.w > 0;
+				const __m256 ox = _mm256_set1_ps(contributionOrigin.x), oy = _mm256_set1_ps(contributionOrigin.y), oz = _mm256_set1_ps(contributionOrigin.z);
+				const __m256 radiusScale = _mm256_set1_ps(contributionOrigin.w);
+				const __m256 distanceScale = _mm256_set1_ps(contributionDistance.x), distanceBias = _mm256_set1_ps(contributionDistance.y);
+				for (; begin + 8 <= end; begin += 8)
+				{
+					const __m256 cx = _mm256_loadu_ps(&bounds.centerX[begin]), cy = _mm256_loadu_ps(&bounds.centerY[begin]), cz = _mm256_loadu_ps(&bounds.centerZ[begin]);
+					const __m256 ex = _mm256_loadu_ps(&bounds.extentX[begin]), ey = _mm256_loadu_ps(&bounds.extentY[begin]), ez = _mm256_loadu_ps(&bounds.extentZ[begin]);
+					__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+					for (const glm::vec4& plane : planes)
+					{
+						const __m256 nx = _mm256_set1_ps(plane.x), ny = _mm256_set1_ps(plane.y), nz = _mm256_set1_ps(plane.z);
+						__m256 distance = _mm256_fmadd_ps(nx, cx, _mm256_set1_ps(plane.w));
+						distance = _mm256_fmadd_ps(ny, cy, distance);
+						distance = _mm256_fmadd_ps(nz, cz, distance);
+						distance = _mm256_fmadd_ps(_mm256_and_ps(nx, absMask), ex, distance);
+						distance = _mm256_fmadd_ps(_mm256_and_ps(ny, absMask), ey, distance);
+						distance = _mm256_fmadd_ps(_mm256_and_ps(nz, absMask), ez, distance);
+						inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+					}
+					if (contribution)
+					{
+						const __m256 squaredRadius = _mm256_fmadd_ps(ez, ez, _mm256_fmadd_ps(ey, ey, _mm256_mul_ps(ex, ex)));
+						const __m256 dx = _mm256_sub_ps(cx, ox), dy = _mm256_sub_ps(cy, oy), dz = _mm256_sub_ps(cz, oz);
+						const __m256 squaredDistance = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+						const __m256 required = _mm256_fmadd_ps(squaredDistance, distanceScale, distanceBias);
+						inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_mul_ps(squaredRadius, radiusScale), required, _CMP_GE_OQ));
+					}
+					const int mask = _mm256_movemask_ps(inside);
+					for (int i = 0; i < 8; i++) visible[begin + i] = (mask >> i) & 1;
+				}
+				return begin;
+			}
+#endif
+		};
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OPENVULKANO_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define OPENVULKANO_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define OPENVULKANO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace openVulkanoCpp
+{
+	namespace Math
+	{
+		/**
+		 * \brief Multiplies arrays of 4x4 matrices. The best kernel for the cpu (AVX2, SSE or scalar) is selected at runtime.
+		 * The output array may be the same as one of the input arrays.
+		 */
+		class MatrixBatch
+		{
+		public:
+			enum class Kernel
+			{
+				Scalar, SSE, AVX2
+			};
+
+			static Kernel GetKernel()
+			{
+				static const Kernel kernel = DetectKernel();
+				return kernel;
+			}
+
+			/**
+			 * \brief Calculates out[i] = lhs * rhs[i]
+			 */
+			static void Multiply(const glm::mat4x4& lhs, const glm::mat4x4* rhs, glm::mat4x4* out, size_t count)
+			{
+				switch (GetKernel())
+				{
+#ifdef OPENVULKANO_X86
+					case Kernel::AVX2: MultiplyAvx2(lhs, rhs, out, count); break;
+					case Kernel::SSE: MultiplySse(lhs, rhs, out, count); break;
+#endif
+					default: MultiplyScalar(lhs, rhs, out, count); break;
+				}
+			}
+
+			static void MultiplyScalar(const glm::mat4x4& lhs, const glm::mat4x4* rhs, glm::mat4x4* out, size_t count)
+			{
+				const glm::mat4x4 left = lhs; // The lhs might be part of the output
+				for (size_t i = 0; i < count; i++)
+				{
+					out[i] = left * rhs[i];
+				}
+			}
+
+#ifdef OPENVULKANO_X86
+			static void MultiplySse(const glm::mat4x4& lhs, const glm::mat4x4* rhs, glm::mat4x4* out, size_t count)
+			{
+				const __m128 c0 = _mm_loadu_ps(&lhs[0][0]), c1 = _mm_loadu_ps(&lhs[1][0]);
+				const __m128 c2 = _mm_loadu_ps(&lhs[2][0]), c3 = _mm_loadu_ps(&lhs[3][0]);
+				for (size_t i = 0; i < count; i++)
+				{
+					const float* r = &rhs[i][0][0];
+					__m128 columns[4];
+					for (int j = 0; j < 4; j++)
+					{
+						const __m128 column = _mm_loadu_ps(r + j * 4);
+						__m128 result = _mm_mul_ps(c0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+						result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+						result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+						result = _mm_add_ps(result, _mm_mul_ps(c3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+						columns[j] = result;
+					}
+					float* o = &out[i][0][0];
+					for (int j = 0; j < 4; j++)
+					{
+						_mm_storeu_ps(o + j * 4, columns[j]);
+					}
+				}
+			}
+
+			OPENVULKANO_TARGET_AVX2 static void MultiplyAvx2(const glm::mat4x4& lhs, const glm::mat4x4* rhs, glm::mat4x4* out, size_t count)
+			{ // Every 256 bit register holds two columns, so the columns of the lhs get duplicated into both lanes
+				const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[0][0]));
+				const __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[1][0]));
+				const __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[2][0]));
+				const __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&lhs[3][0]));
+				for (size_t i = 0; i < count; i++)
+				{
+					const float* r = &rhs[i][0][0];
+					const __m256 columns01 = _mm256_loadu_ps(r), columns23 = _mm256_loadu_ps(r + 8);
+					__m256 result01 = _mm256_mul_ps(c0, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(0, 0, 0, 0)));
+					__m256 result23 = _mm256_mul_ps(c0, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(0, 0, 0, 0)));
+					result01 = _mm256_fmadd_ps(c1, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(1, 1, 1, 1)), result01);
+					result23 = _mm256_fmadd_ps(c1, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(1, 1, 1, 1)), result23);
+					result01 = _mm256_fmadd_ps(c2, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(2, 2, 2, 2)), result01);
+					result23 = _mm256_fmadd_ps(c2, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(2, 2, 2, 2)), result23);
+					result01 = _mm256_fmadd_ps(c3, _mm256_shuffle_ps(columns01, columns01, _MM_SHUFFLE(3, 3, 3, 3)), result01);
+					result23 = _mm256_fmadd_ps(c3, _mm256_shuffle_ps(columns23, columns23, _MM_SHUFFLE(3, 3, 3, 3)), result23);
+					float* o = &out[i][0][0];
+					_mm256_storeu_ps(o, result01);
+					_mm256_storeu_ps(o + 8, result23);
+				}
+			}
+#endif
+
+		private:
+			static Kernel DetectKernel()
+			{
+#ifdef OPENVULKANO_X86
+				int info[4];
+				CpuId(info, 0, 0);
+				const int maxLeaf = info[0];
+				CpuId(info, 1, 0);
+				const bool sse = (info[3] & (1 << 25)) != 0;
+				const bool fma = (info[2] & (1 << 12)) != 0, osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+				if (maxLeaf >= 7 && fma && osxsave && avx && (GetXcr0() & 6) == 6)
+				{ // The OS also needs to save the ymm registers
+					CpuId(info, 7, 0);
+					if (info[1] & (1 << 5)) return Kernel::AVX2;
+				}
+				if (sse) return Kernel::SSE;
+#endif
+				return Kernel::Scalar;
+			}
+
+#ifdef OPENVULKANO_X86
+			static void CpuId(int info[4], int leaf, int subLeaf)
+			{
+#ifdef _MSC_VER
+				__cpuidex(info, leaf, subLeaf);
+#else
+				unsigned int a, b, c, d;
+				__cpuid_count(leaf, subLeaf, a, b, c, d);
+				info[0] = static_cast<int>(a); info[1] = static_cast<int>(b); info[2] = static_cast<int>(c); info[3] = static_cast<int>(d);
+#endif
+			}
+
+			static uint64_t GetXcr0()
+			{
+#ifdef _MSC_VER
+				return _xgetbv(0);
+#else
+				uint32_t eax, edx;
+				__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+				return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+			}
+#endif
+		};
+	}
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "MatrixBatch.hpp"
+#include "BoundsArray.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Math
+	{
+		/**
+		 * \brief A ray with a precalculated inverse direction for fast box intersection tests.
+		 * The simd kernel used for testing many boxes at once is selected at runtime the same way as the one of the MatrixBatch.
+		 */
+		struct Ray
+		{
+			glm::vec3 origin, direction, inverseDirection;
+
+			Ray() : Ray(glm::vec3(0), glm::vec3(0, 0, 1)) {}
+
+			/**
+			 * \param origin The start point of the ray
+			 * \param direction The direction of the ray, distances will be measured in multiples of its length
+			 */
+			Ray(const glm::vec3& origin, const glm::vec3& direction)
+				: origin(origin), direction(direction), inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z)
+			{}
+
+			glm::vec3 GetPoint(float distance) const
+			{
+				return origin + direction * distance;
+			}
+
+			/**
+			 * \brief Transforms the ray, distances along the transformed ray are the same as along the original one.
+			 */
+			Ray Transform(const glm::mat4x4& mat) const
+			{
+				return Ray(glm::vec3(mat * glm::vec4(origin, 1)), glm::vec3(mat * glm::vec4(direction, 0)));
+			}
+
+			/**
+			 * \brief Intersects the ray with an axis aligned box (slab test).
+			 * \param min The minimum of the box
+			 * \param max The maximum of the box
+			 * \param maxDistance Intersections further away will be ignored
+			 * \param distance Receives the distance at which the ray enters the box, 0 if the origin is inside of it
+			 * \return true if the ray hits the box within [0, maxDistance]
+			 */
+			bool IntersectBox(const glm::vec3& min, const glm::vec3& max, float maxDistance, float& distance) const
+			{
+				float exitDistance;
+				return IntersectBox(min, max, maxDistance, distance, exitDistance);
+			}
+
+			/**
+			 * \brief Intersects the ray with an axis aligned box (slab test).
+			 * \param exitDistance Receives the distance at which the ray leaves the box, limited to maxDistance
+			 */
+			bool IntersectBox(const glm::vec3& min, const glm::vec3& max, float maxDistance, float& distance, float& exitDistance) const
+			{
+				const glm::vec3 t0 = (min - origin) * inverseDirection, t1 = (max - origin) * inverseDirection;
+				const glm::vec3 entry = glm::min(t0, t1), exit = glm::max(t0, t1);
+				// std::max and std::min return their first argument if the second one is NaN (0 * inf), so NaNs are ignored
+				distance = std::max(std::max(std::max(0.0f, entry.x), entry.y), entry.z);
+				exitDistance = std::min(std::min(std::min(maxDistance, exit.x), exit.y), exit.z);
+				return distance <= exitDistance;
+			}
+
+			/**
+			 * \brief Intersects the ray with a range of boxes.
+			 * \param bounds The boxes to check
+			 * \param begin The index of the first box
+			 * \param end The index after the last box
+			 * \param maxDistance Intersections further away will be ignored
+			 * \param distances Receives the distance at which the ray enters every box or INFINITY if the box is missed, indexed like the bounds
+			 */
+			void IntersectBoxes(const BoundsArray& bounds, size_t begin, size_t end, float maxDistance, float* distances) const
+			{
+				switch (MatrixBatch::GetKernel())
+				{
+#ifdef OPENVULKANO_X86
+					case MatrixBatch::Kernel::AVX2: begin = IntersectBoxesAvx2(bounds, begin, end, maxDistance, distances); break;
+					case MatrixBatch::Kernel::SSE: begin = IntersectBoxesSse(bounds, begin, end, maxDistance, distances); break;
+#endif
+					default: break;
+				}
+				for (; begin < end; begin++)
+				{
+					const glm::vec3 center = bounds.GetCenter(begin), extent = bounds.GetExtent(begin);
+					float distance;
+					distances[begin] = IntersectBox(center - extent, center + extent, maxDistance, distance) ? distance : INFINITY;
+				}
+			}
+
+			/**
+			 * \brief Intersects the ray with a triangle (Moeller-Trumbore), both sides of the triangle can be hit.
+			 * \param distance Receives the distance of the hit
+			 * \return true if the ray hits the triangle within [0, maxDistance]
+			 */
+			bool IntersectTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float maxDistance, float& distance) const
+			{
+				const glm::vec3 edge1 = v1 - v0, edge2 = v2 - v0;
+				const glm::vec3 p = glm::cross(direction, edge2);
+				const float determinant = glm::dot(edge1, p);
+				if (std::abs(determinant) < 1e-12f) return false; // The ray is parallel to the triangle
+				const float inverseDeterminant = 1.0f / determinant;
+				const glm::vec3 t = origin - v0;
+				const float u = glm::dot(t, p) * inverseDeterminant;
+				if (u < 0 || u > 1) return false;
+				const glm::vec3 q = glm::cross(t, edge1);
+				const float v = glm::dot(direction, q) * inverseDeterminant;
+				if (v < 0 || u + v > 1) return false;
+				distance = glm::dot(edge2, q) * inverseDeterminant;
+				return distance >= 0 && distance <= maxDistance;
+			}
+
+		private:
+#ifdef OPENVULKANO_X86
+			/**
+			 * \return The index of the first box that has not been processed
+			 */
+			size_t IntersectBoxesSse(const BoundsArray& bounds, size_t begin, size_t end, float maxDistance, float* distances) const
+			{
+				const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+				const __m128 ix = _mm_set1_ps(inverseDirection.x), iy = _mm_set1_ps(inverseDirection.y), iz = _mm_set1_ps(inverseDirection.z);
+				const __m128 farStart = _mm_set1_ps(maxDistance), miss = _mm_set1_ps(INFINITY);
+				for (; begin + 4 <= end; begin += 4)
+				{
+					__m128 near = _mm_setzero_ps(), far = farStart;
+					const auto slab = [&](const float* center, const float* extent, __m128 o, __m128 i)
+					{
+						const __m128 c = _mm_loadu_ps(center + begin), e = _mm_loadu_ps(extent + begin);
+						const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(c, e), o), i);
+						const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(c, e), o), i);
+						near = _mm_max_ps(_mm_min_ps(t0, t1), near); // min/max return the second operand for NaNs
+						far = _mm_min_ps(_mm_max_ps(t0, t1), far);
+					};
+					slab(bounds.centerX.data(), bounds.extentX.data(), ox, ix);
+					slab(bounds.centerY.data(), bounds.extentY.data(), oy, iy);
+					slab(bounds.centerZ.data(), bounds.extentZ.data(), oz, iz);
+					const __m128 hit = _mm_cmple_ps(near, far);
+					_mm_storeu_ps(distances + begin, _mm_or_ps(_mm_and_ps(hit, near), _mm_andnot_ps(hit, miss)));
+				}
+				return begin;
+			}
+
+			OPENVULKANO_TARGET_AVX2 size_t IntersectBoxesAvx2(const BoundsArray& bounds, size_t begin, size_t end, float maxDistance, float* distances) const
+			{
+				const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+				const __m256 ix = _mm256_set1_ps(inverseDirection.x), iy = _mm256_set1_ps(inverseDirection.y), iz = _mm256_set1_ps(inverseDirection.z);
+				const __m256 farStart = _mm256_set1_ps(maxDistance), miss = _mm256_set1_ps(INFINITY);
+				for (; begin + 8 <= end; begin += 8)
+				{
+					__m256 near = _mm256_setzero_ps(), far = farStart;
+					const __m256 nearX = SlabAvx2(bounds.centerX.data() + begin, bounds.extentX.data() + begin, ox, ix, far);
+					const __m256 nearY = SlabAvx2(bounds.centerY.data() + begin, bounds.extentY.data() + begin, oy, iy, far);
+					const __m256 nearZ = SlabAvx2(bounds.centerZ.data() + begin, bounds.extentZ.data() + begin, oz, iz, far);
+					near = _mm256_max_ps(nearX, near);
+					near = _mm256_max_ps(nearY, near);
+					near = _mm256_max_ps(nearZ, near);
+					const __m256 hit = _mm256_cmp_ps(near, far, _CMP_LE_OQ);
+					_mm256_storeu_ps(distances + begin, _mm256_blendv_ps(miss, near, hit));
+				}
+				return begin;
+			}
+
+			/**
+			 * \brief Calculates the entry distances of one axis and shrinks the exit distances.
+			 */
+			static OPENVULKANO_TARGET_AVX2 __m256 SlabAvx2(const float* center, const float* extent, __m256 o, __m256 i, __m256& far)
+			{ // Lambdas don't inherit the target attribute, so the slab test is a separate function
+				const __m256 c = _mm256_loadu_ps(center), e = _mm256_loadu_ps(extent);
+				const __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(c, e), o), i);
+				const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(c, e), o), i);
+				far = _mm256_min_ps(_mm256_max_ps(t0, t1), far);
+				return _mm256_min_ps(t0, t1);
+			}
+#endif
+		};
+	}
+}
@@ -61,9 +61,28 @@ namespace openVulkanoCpp
 				max = glm::max(max, otherAABB.GetMax());
 			}
 
-			void Grow(const AABB& otherAABB, glm::mat4x4 transformation)
+			/**
+			 * \brief Grows the AABB so it encloses an other AABB after it has been transformed.
+			 * Only the center and the extent of the other AABB get transformed, instead of all its eight corners.
+			 * \param otherAABB The AABB that should be enclosed
+			 * \param transformation The transformation that should be applied to the other AABB
+			 */
+			void Grow(const AABB& otherAABB, const glm::mat4x4& transformation)
+			{
+				if (otherAABB.IsEmpty()) return;
+				const glm::vec3 center = otherAABB.GetCenter(), extent = otherAABB.GetDiagonal() * 0.5f;
+				const glm::vec3 newCenter = glm::vec3(transformation * glm::vec4(center, 1));
+				const glm::vec3 newExtent = glm::abs(glm::vec3(transformation[0])) * extent.x + glm::abs(glm::vec3(transformation[1])) * extent.y + glm::abs(glm::vec3(transformation[2])) * extent.z;
+				Grow(newCenter - newExtent);
+				Grow(newCenter + newExtent);
+			}
+
+			/**
+			 * \brief Checks if the AABB does not contain anything (it has not been grown since it was initialized)
+			 */
+			bool IsEmpty() const
 			{
-				//TODO
+				return min.x > max.x || min.y > max.y || min.z > max.z;
 			}
 
 			glm::vec3 GetDiagonal() const
@@ -0,0 +1,623 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "ISpatialIndex.hpp"
+#include "Node.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Bounding volume hierarchy over the world bounds of the nodes of a scene, made of two trees.
+		 * Static nodes (UpdateFrequency::Never) are stored in a tree that is built top down with the surface area heuristic (SAH),
+		 * it gets rebuilt once per update if static nodes have been added and refitted if they are moved.
+		 * All other nodes are stored in a tree that is balanced incrementally with tree rotations. Its leaves are enlarged by a margin,
+		 * nodes that stay inside of their enlarged box don't change the tree, all others are removed and reinserted in O(log n).
+		 */
+		class Bvh final : public ISpatialIndex
+		{
+			static constexpr uint32_t NONE = UINT32_MAX;
+			static constexpr uint32_t STATIC_FLAG = 0x80000000; // The node is a leaf of the static tree
+			static constexpr uint32_t PENDING_FLAG = 0x40000000; // The node waits for the static tree to be rebuilt
+			static constexpr uint32_t SLOT_MASK = 0x3FFFFFFF;
+			static constexpr uint32_t SAH_BINS = 16;
+
+			struct TreeNode
+			{
+				glm::vec3 min, max;
+				uint32_t parent, left, right;
+				int32_t height; // 0 for leaves, -1 for free nodes
+				Node* item;
+
+				bool IsLeaf() const
+				{
+					return left == NONE;
+				}
+			};
+
+			struct BuildItem
+			{
+				glm::vec3 min, max, centroid;
+				Node* node;
+			};
+
+			class Tree
+			{
+			public:
+				std::vector<TreeNode> nodes;
+				uint32_t root = NONE, freeList = NONE;
+				size_t leafCount = 0;
+
+				void Clear()
+				{
+					nodes.clear();
+					root = freeList = NONE;
+					leafCount = 0;
+				}
+
+				uint32_t CreateLeaf(Node* item, const glm::vec3& min, const glm::vec3& max)
+				{
+					const uint32_t leaf = Allocate();
+					TreeNode& node = nodes[leaf];
+					node.min = min;
+					node.max = max;
+					node.left = node.right = NONE;
+					node.height = 0;
+					node.item = item;
+					InsertLeaf(leaf);
+					leafCount++;
+					return leaf;
+				}
+
+				void DestroyLeaf(uint32_t leaf)
+				{
+					RemoveLeaf(leaf);
+					Free(leaf);
+					leafCount--;
+				}
+
+				/**
+				 * \brief Finds the best sibling for a leaf by descending the tree along the smallest increase of surface area.
+				 */
+				void InsertLeaf(uint32_t leaf)
+				{
+					if (root == NONE)
+					{
+						root = leaf;
+						nodes[leaf].parent = NONE;
+						return;
+					}
+					const glm::vec3 leafMin = nodes[leaf].min, leafMax = nodes[leaf].max;
+					uint32_t index = root;
+					while (!nodes[index].IsLeaf())
+					{
+						const TreeNode& node = nodes[index];
+						const float area = Area(node.min, node.max);
+						const float combinedArea = Area(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+						const float cost = 2 * combinedArea; // Cost of creating a new parent for this node and the leaf
+						const float inheritanceCost = 2 * (combinedArea - area); // Minimum cost of pushing the leaf further down
+						const float leftCost = DescendCost(node.left, leafMin, leafMax) + inheritanceCost;
+						const float rightCost = DescendCost(node.right, leafMin, leafMax) + inheritanceCost;
+						if (cost < leftCost && cost < rightCost) break;
+						index = (leftCost < rightCost) ? node.left : node.right;
+					}
+					const uint32_t sibling = index;
+					const uint32_t oldParent = nodes[sibling].parent;
+					const uint32_t newParent = Allocate();
+					TreeNode& parent = nodes[newParent];
+					parent.parent = oldParent;
+					parent.left = sibling;
+					parent.right = leaf;
+					parent.item = nullptr;
+					parent.height = nodes[sibling].height + 1;
+					parent.min = glm::min(nodes[sibling].min, leafMin);
+					parent.max = glm::max(nodes[sibling].max, leafMax);
+					if (oldParent == NONE) root = newParent;
+					else if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+					else nodes[oldParent].right = newParent;
+					nodes[sibling].parent = newParent;
+					nodes[leaf].parent = newParent;
+					FixUpwards(newParent);
+				}
+
+				void RemoveLeaf(uint32_t leaf)
+				{
+					if (leaf == root)
+					{
+						root = NONE;
+						return;
+					}
+					const uint32_t parent = nodes[leaf].parent;
+					const uint32_t grandParent = nodes[parent].parent;
+					const uint32_t sibling = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+					nodes[sibling].parent = grandParent;
+					Free(parent);
+					if (grandParent == NONE)
+					{
+						root = sibling;
+						return;
+					}
+					if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+					else nodes[grandParent].right = sibling;
+					FixUpwards(grandParent);
+				}
+
+				/**
+				 * \brief Changes the box of a leaf and enlarges or shrinks its ancestors without changing the structure of the tree.
+				 */
+				void Refit(uint32_t leaf, const glm::vec3& min, const glm::vec3& max)
+				{
+					nodes[leaf].min = min;
+					nodes[leaf].max = max;
+					for (uint32_t index = nodes[leaf].parent; index != NONE; index = nodes[index].parent)
+					{
+						TreeNode& node = nodes[index];
+						node.min = glm::min(nodes[node.left].min, nodes[node.right].min);
+						node.max = glm::max(nodes[node.left].max, nodes[node.right].max);
+					}
+				}
+
+				/**
+				 * \brief Replaces the content of the tree with a tree built top down with a binned surface area heuristic.
+				 */
+				void Build(std::vector<BuildItem>& items)
+				{
+					Clear();
+					if (items.empty()) return;
+					nodes.reserve(items.size() * 2 - 1);
+					root = BuildRange(items, 0, items.size(), NONE);
+					leafCount = items.size();
+				}
+
+				template<typename Test, typename Visit>
+				void Query(const Test& test, const Visit& visit) const
+				{
+					if (root == NONE) return;
+					static thread_local std::vector<uint32_t> stack; // Reused to avoid an allocation per query
+					stack.clear();
+					stack.push_back(root);
+					while (!stack.empty())
+					{
+						const TreeNode& node = nodes[stack.back()];
+						stack.pop_back();
+						if (!test(node.min, node.max)) continue;
+						if (node.IsLeaf()) visit(node.item, node.min, node.max);
+						else
+						{
+							stack.push_back(node.left);
+							stack.push_back(node.right);
+						}
+					}
+				}
+
+				/**
+				 * \brief Visits the leaves hit by a ray, the nearer child of every node is visited first.
+				 * \param limit The maximum distance, it is updated with the return value of the visitor and used to skip the remaining nodes
+				 */
+				template<typename Visit>
+				void TraverseRay(const Math::Ray& ray, float& limit, const Visit& visit) const
+				{
+					float distance;
+					if (root == NONE || !ray.IntersectBox(nodes[root].min, nodes[root].max, limit, distance)) return;
+					static thread_local std::vector<std::pair<uint32_t, float>> stack;
+					stack.clear();
+					stack.emplace_back(root, distance);
+					while (!stack.empty())
+					{
+						const std::pair<uint32_t, float> entry = stack.back();
+						stack.pop_back();
+						if (entry.second > limit) continue;
+						const TreeNode& node = nodes[entry.first];
+						if (node.IsLeaf())
+						{
+							limit = visit(node.item, node.min, node.max, entry.second);
+							continue;
+						}
+						float leftDistance, rightDistance;
+						const bool hitLeft = ray.IntersectBox(nodes[node.left].min, nodes[node.left].max, limit, leftDistance);
+						const bool hitRight = ray.IntersectBox(nodes[node.right].min, nodes[node.right].max, limit, rightDistance);
+						if (hitLeft && hitRight)
+						{ // The nearer child is pushed last, so it will be visited first
+							const bool leftFirst = leftDistance <= rightDistance;
+							stack.emplace_back(leftFirst ? node.right : node.left, leftFirst ? rightDistance : leftDistance);
+							stack.emplace_back(leftFirst ? node.left : node.right, leftFirst ? leftDistance : rightDistance);
+						}
+						else if (hitLeft) stack.emplace_back(node.left, leftDistance);
+						else if (hitRight) stack.emplace_back(node.right, rightDistance);
+					}
+				}
+
+			private:
+				static float Area(const glm::vec3& min, const glm::vec3& max)
+				{ // Half of the surface area, only used for comparisons
+					const glm::vec3 size = max - min;
+					return size.x * size.y + size.y * size.z + size.z * size.x;
+				}
+
+				float DescendCost(uint32_t index, const glm::vec3& leafMin, const glm::vec3& leafMax) const
+				{
+					const TreeNode& node = nodes[index];
+					const float combinedArea = Area(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+					return node.IsLeaf() ? combinedArea : combinedArea - Area(node.min, node.max);
+				}
+
+				uint32_t Allocate()
+				{
+					if (freeList == NONE)
+					{
+						nodes.emplace_back();
+						return static_cast<uint32_t>(nodes.size() - 1);
+					}
+					const uint32_t index = freeList;
+					freeList = nodes[index].parent;
+					return index;
+				}
+
+				void Free(uint32_t index)
+				{
+					nodes[index].parent = freeList;
+					nodes[index].height = -1;
+					nodes[index].item = nullptr;
+					freeList = index;
+				}
+
+				void FixUpwards(uint32_t index)
+				{
+					while (index != NONE)
+					{
+						index = Balance(index);
+						SetChildBounds(nodes[index]);
+						index = nodes[index].parent;
+					}
+				}
+
+				void SetChildBounds(TreeNode& node)
+				{
+					const TreeNode &left = nodes[node.left], &right = nodes[node.right];
+					node.min = glm::min(left.min, right.min);
+					node.max = glm::max(left.max, right.max);
+					node.height = 1 + std::max(left.height, right.height);
+				}
+
+				void ReplaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+				{
+					if (parent == NONE) root = newChild;
+					else if (nodes[parent].left == oldChild) nodes[parent].left = newChild;
+					else nodes[parent].right = newChild;
+				}
+
+				/**
+				 * \brief Rotates the higher child of a node up if the heights of its children differ by more than one.
+				 * \return The index of the node that took the place of the given one
+				 */
+				uint32_t Balance(uint32_t indexA)
+				{
+					TreeNode& a = nodes[indexA];
+					if (a.IsLeaf() || a.height < 2) return indexA;
+					const uint32_t indexB = a.left, indexC = a.right;
+					const int32_t balance = nodes[indexC].height - nodes[indexB].height;
+					if (balance > 1)
+					{ // C becomes the parent of A, A keeps the lower child of C
+						TreeNode& c = nodes[indexC];
+						const uint32_t indexF = c.left, indexG = c.right;
+						c.left = indexA;
+						c.parent = a.parent;
+						a.parent = indexC;
+						ReplaceChild(c.parent, indexA, indexC);
+						const bool keepF = nodes[indexF].height > nodes[indexG].height;
+						const uint32_t moved = keepF ? indexG : indexF;
+						c.right = keepF ? indexF : indexG;
+						a.right = moved;
+						nodes[moved].parent = indexA;
+						SetChildBounds(a);
+						SetChildBounds(c);
+						return indexC;
+					}
+					if (balance < -1)
+					{ // B becomes the parent of A, A keeps the lower child of B
+						TreeNode& b = nodes[indexB];
+						const uint32_t indexD = b.left, indexE = b.right;
+						b.left = indexA;
+						b.parent = a.parent;
+						a.parent = indexB;
+						ReplaceChild(b.parent, indexA, indexB);
+						const bool keepD = nodes[indexD].height > nodes[indexE].height;
+						const uint32_t moved = keepD ? indexE : indexD;
+						b.right = keepD ? indexD : indexE;
+						a.left = moved;
+						nodes[moved].parent = indexA;
+						SetChildBounds(a);
+						SetChildBounds(b);
+						return indexB;
+					}
+					return indexA;
+				}
+
+				uint32_t BuildRange(std::vector<BuildItem>& items, size_t begin, size_t end, uint32_t parent)
+				{
+					const uint32_t index = Allocate();
+					nodes[index].parent = parent;
+					nodes[index].item = nullptr;
+					if (end - begin == 1)
+					{
+						TreeNode& leaf = nodes[index];
+						leaf.min = items[begin].min;
+						leaf.max = items[begin].max;
+						leaf.left = leaf.right = NONE;
+						leaf.height = 0;
+						leaf.item = items[begin].node;
+						return index;
+					}
+					glm::vec3 centroidMin = items[begin].centroid, centroidMax = items[begin].centroid;
+					for (size_t i = begin + 1; i < end; i++)
+					{
+						centroidMin = glm::min(centroidMin, items[i].centroid);
+						centroidMax = glm::max(centroidMax, items[i].centroid);
+					}
+					const glm::vec3 centroidSize = centroidMax - centroidMin;
+					const int axis = (centroidSize.x >= centroidSize.y && centroidSize.x >= centroidSize.z) ? 0 : ((centroidSize.y >= centroidSize.z) ? 1 : 2);
+					size_t mid = begin;
+					if (centroidSize[axis] > 0)
+					{
+						const float scale = SAH_BINS / centroidSize[axis];
+						const float offset = centroidMin[axis];
+						auto binOf = [&](const BuildItem& item)
+						{
+							return std::min<uint32_t>(SAH_BINS - 1, static_cast<uint32_t>((item.centroid[axis] - offset) * scale));
+						};
+						uint32_t counts[SAH_BINS] = {};
+						glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+						std::fill_n(binMin, SAH_BINS, glm::vec3(INFINITY));
+						std::fill_n(binMax, SAH_BINS, glm::vec3(-INFINITY));
+						for (size_t i = begin; i < end; i++)
+						{
+							const uint32_t bin = binOf(items[i]);
+							counts[bin]++;
+							binMin[bin] = glm::min(binMin[bin], items[i].min);
+							binMax[bin] = glm::max(binMax[bin], items[i].max);
+						}
+						// Sweep from the right to get the cost of the right side of every split, then from the left to find the cheapest one
+						float rightCosts[SAH_BINS];
+						glm::vec3 sweepMin(INFINITY), sweepMax(-INFINITY);
+						uint32_t sweepCount = 0;
+						for (uint32_t bin = SAH_BINS - 1; bin > 0; bin--)
+						{
+							sweepMin = glm::min(sweepMin, binMin[bin]);
+							sweepMax = glm::max(sweepMax, binMax[bin]);
+							sweepCount += counts[bin];
+							rightCosts[bin] = sweepCount ? Area(sweepMin, sweepMax) * sweepCount : 0;
+						}
+						sweepMin = glm::vec3(INFINITY);
+						sweepMax = glm::vec3(-INFINITY);
+						sweepCount = 0;
+						float bestCost = INFINITY;
+						uint32_t bestSplit = 0;
+						for (uint32_t split = 1; split < SAH_BINS; split++)
+						{
+							sweepMin = glm::min(sweepMin, binMin[split - 1]);
+							sweepMax = glm::max(sweepMax, binMax[split - 1]);
+							sweepCount += counts[split - 1];
+							const float cost = (sweepCount ? Area(sweepMin, sweepMax) * sweepCount : 0) + rightCosts[split];
+							if (cost < bestCost)
+							{
+								bestCost = cost;
+								bestSplit = split;
+							}
+						}
+						mid = std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem& item) { return binOf(item) < bestSplit; }) - items.begin();
+					}
+					if (mid == begin || mid == end)
+					{ // All centroids are in the same bin, split in the middle
+						mid = (begin + end) / 2;
+						std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+										 [axis](const BuildItem& a, const BuildItem& b) { return a.centroid[axis] < b.centroid[axis]; });
+					}
+					const uint32_t left = BuildRange(items, begin, mid, index);
+					const uint32_t right = BuildRange(items, mid, end, index);
+					nodes[index].left = left;
+					nodes[index].right = right;
+					SetChildBounds(nodes[index]);
+					return index;
+				}
+			};
+
+			Tree staticTree, dynamicTree;
+			std::vector<Node*> pendingStatic;
+			std::vector<BuildItem> buildItems;
+			size_t staticRefits = 0;
+
+		public:
+			Bvh() = default;
+
+			~Bvh() override
+			{
+				Bvh::Clear();
+			}
+
+			void Update(Node* const* nodes, size_t count, WorkerPool* pool = nullptr) override
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					UpdateNode(nodes[i]);
+				}
+				// Refitting keeps the static tree valid, but its quality degrades if many static nodes get moved
+				if (!pendingStatic.empty() || staticRefits > staticTree.leafCount / 4) RebuildStatic();
+			}
+
+			void Remove(Node* node) override
+			{
+				const uint32_t slot = node->spatialIndexSlot;
+				if (slot == INVALID_SLOT) return;
+				if (slot & PENDING_FLAG)
+				{
+					const uint32_t index = slot & SLOT_MASK;
+					pendingStatic[index] = pendingStatic.back();
+					pendingStatic[index]->spatialIndexSlot = PENDING_FLAG | index;
+					pendingStatic.pop_back();
+				}
+				else if (slot & STATIC_FLAG) staticTree.DestroyLeaf(slot & SLOT_MASK);
+				else dynamicTree.DestroyLeaf(slot);
+				node->spatialIndexSlot = INVALID_SLOT;
+			}
+
+			void Clear() override
+			{
+				for (const Tree* tree : { &staticTree, &dynamicTree })
+				{
+					for (const TreeNode& node : tree->nodes)
+					{
+						if (node.height == 0) node.item->spatialIndexSlot = INVALID_SLOT;
+					}
+				}
+				for (Node* node : pendingStatic)
+				{
+					node->spatialIndexSlot = INVALID_SLOT;
+				}
+				staticTree.Clear();
+				dynamicTree.Clear();
+				pendingStatic.clear();
+				staticRefits = 0;
+			}
+
+			size_t Size() const override
+			{
+				return staticTree.leafCount + dynamicTree.leafCount + pendingStatic.size();
+			}
+
+			void QueryFrustum(const Math::Frustum& frustum, std::vector<Node*>& result) const override
+			{
+				Query([&frustum](const glm::vec3& min, const glm::vec3& max)
+				{
+					return frustum.IsVisible((min + max) * 0.5f, (max - min) * 0.5f);
+				}, [&result](Node* node, const glm::vec3&, const glm::vec3&) { result.push_back(node); });
+			}
+
+			void QueryAABB(const AABB& bounds, std::vector<Node*>& result) const override
+			{
+				const glm::vec3 boundsMin = bounds.GetMin(), boundsMax = bounds.GetMax();
+				Query([&](const glm::vec3& min, const glm::vec3& max)
+				{
+					return min.x <= boundsMax.x && max.x >= boundsMin.x && min.y <= boundsMax.y && max.y >= boundsMin.y && min.z <= boundsMax.z && max.z >= boundsMin.z;
+				}, [&result](Node* node, const glm::vec3&, const glm::vec3&) { result.push_back(node); });
+			}
+
+			void TraverseRay(const Math::Ray& ray, float maxDistance, const std::function<float(Node*, float)>& visitor) const override
+			{
+				float limit = maxDistance;
+				staticTree.TraverseRay(ray, limit, [&](Node* node, const glm::vec3&, const glm::vec3&, float distance)
+				{ // The leaves of the static tree are not enlarged
+					return visitor(node, distance);
+				});
+				dynamicTree.TraverseRay(ray, limit, [&](Node* node, const glm::vec3&, const glm::vec3&, float)
+				{
+					glm::vec3 min, max;
+					float distance;
+					node->GetTransformStorage()->GetWorldBounds(node->GetTransformIndex(), min, max);
+					return ray.IntersectBox(min, max, limit, distance) ? visitor(node, distance) : limit;
+				});
+			}
+
+		private:
+			/**
+			 * \brief Runs a query on both trees. The visitor receives the exact world bounds of the nodes that passed the test.
+			 */
+			template<typename Test, typename Visit>
+			void Query(const Test& test, const Visit& visit) const
+			{
+				staticTree.Query(test, visit); // The leaves of the static tree are not enlarged
+				dynamicTree.Query(test, [&](Node* node, const glm::vec3&, const glm::vec3&)
+				{
+					glm::vec3 min, max;
+					node->GetTransformStorage()->GetWorldBounds(node->GetTransformIndex(), min, max);
+					if (test(min, max)) visit(node, min, max);
+				});
+			}
+
+			/**
+			 * \brief Gets the margin by which the leaves of the dynamic tree get enlarged, 10% of the size of the node.
+			 */
+			static glm::vec3 GetFatMargin(const glm::vec3& min, const glm::vec3& max)
+			{
+				return (max - min) * 0.1f;
+			}
+
+			void UpdateNode(Node* node)
+			{
+				uint32_t slot = node->spatialIndexSlot;
+				if (node->drawables.empty())
+				{
+					Remove(node);
+					return;
+				}
+				const bool isStatic = node->GetUpdateFrequency() == UpdateFrequency::Never;
+				if (slot != INVALID_SLOT && ((slot & (STATIC_FLAG | PENDING_FLAG)) != 0) != isStatic)
+				{ // The update frequency of the node has been changed
+					Remove(node);
+					slot = INVALID_SLOT;
+				}
+				if (slot != INVALID_SLOT && (slot & PENDING_FLAG)) return; // The bounds will be read when the static tree gets rebuilt
+				if (isStatic && slot == INVALID_SLOT)
+				{
+					node->spatialIndexSlot = PENDING_FLAG | static_cast<uint32_t>(pendingStatic.size());
+					pendingStatic.push_back(node);
+					return;
+				}
+				glm::vec3 min, max;
+				node->GetTransformStorage()->GetWorldBounds(node->GetTransformIndex(), min, max);
+				if (isStatic)
+				{
+					staticTree.Refit(slot & SLOT_MASK, min, max);
+					staticRefits++;
+					return;
+				}
+				if (slot == INVALID_SLOT)
+				{
+					const glm::vec3 margin = GetFatMargin(min, max);
+					node->spatialIndexSlot = dynamicTree.CreateLeaf(node, min - margin, max + margin);
+					return;
+				}
+				TreeNode& leaf = dynamicTree.nodes[slot];
+				if (min.x >= leaf.min.x && min.y >= leaf.min.y && min.z >= leaf.min.z && max.x <= leaf.max.x && max.y <= leaf.max.y && max.z <= leaf.max.z) return;
+				const glm::vec3 margin = GetFatMargin(min, max);
+				dynamicTree.RemoveLeaf(slot);
+				leaf.min = min - margin;
+				leaf.max = max + margin;
+				dynamicTree.InsertLeaf(slot);
+			}
+
+			void RebuildStatic()
+			{
+				buildItems.clear();
+				buildItems.reserve(staticTree.leafCount + pendingStatic.size());
+				for (const TreeNode& node : staticTree.nodes)
+				{
+					if (node.height == 0) AddBuildItem(node.item);
+				}
+				for (Node* node : pendingStatic)
+				{
+					AddBuildItem(node);
+				}
+				pendingStatic.clear();
+				staticRefits = 0;
+				staticTree.Build(buildItems);
+				for (uint32_t i = 0; i < staticTree.nodes.size(); i++)
+				{
+					const TreeNode& node = staticTree.nodes[i];
+					if (node.height == 0) node.item->spatialIndexSlot = STATIC_FLAG | i;
+				}
+			}
+
+			void AddBuildItem(Node* node)
+			{
+				BuildItem item;
+				node->GetTransformStorage()->GetWorldBounds(node->GetTransformIndex(), item.min, item.max);
+				item.centroid = (item.min + item.max) * 0.5f;
+				item.node = node;
+				buildItems.push_back(item);
+			}
+		};
+	}
+}
@@ -27,6 +27,7 @@ namespace openVulkanoCpp
 				this->nearPlane = nearPlane;
 				this->farPlane = farPlane;
 				Node::Init();
+				view = glm::mat4x4(1);
 				UpdateProjectionMatrix();
 			}
 
@@ -65,21 +66,28 @@ namespace openVulkanoCpp
 				viewProjection = projection * glm::mat4x4(1,0,0,0,0,-1,0,0,0,0,1,0,0,0,0,1) * view;
 			}
 
-			void UpdateWorldMatrix(const glm::mat4x4& parentWorldMat) override
+			/**
+			 * \brief Recalculates the view matrix from the current world matrix of the camera.
+			 */
+			void UpdateViewMatrix()
 			{
-				Node::UpdateWorldMatrix(parentWorldMat);
 				view = glm::inverse(GetWorldMatrix());
 				UpdateViewProjectionMatrix();
 			}
 
-			const glm::mat4x4& GetViewProjectionMatrix() const
+			/**
+			 * \brief Gets the view projection matrix. If the camera or one of its parents has been moved since the last
+			 * Scene::UpdateWorldMatrices, the view matrix will be rebuilt from the current world matrix first.
+			 */
+			const glm::mat4x4& GetViewProjectionMatrix()
 			{
+				if (IsWorldMatrixDirty()) UpdateViewMatrix();
 				return viewProjection;
 			}
 
-			const glm::mat4x4* GetViewProjectionMatrixPointer() const
+			const glm::mat4x4* GetViewProjectionMatrixPointer()
 			{
-				return &viewProjection;
+				return &GetViewProjectionMatrix();
 			}
 		};
 
@@ -0,0 +1,234 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Node.hpp"
+#include "OcclusionCuller.hpp"
+#include "LodSelector.hpp"
+#include "PotentiallyVisibleSet.hpp"
+#include "../Math/Frustum.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief The visible node/drawable pairs of a scene. The nodes of all drawables are stored in one continuous array,
+		 * the nodes of the drawable i are in the range [offsets[i], offsets[i + 1]).
+		 * Drawables without visible nodes are not part of the list. If levels of detail are selected, a drawable is part of the list once
+		 * for every level that is used by one of its visible nodes.
+		 */
+		class DrawList final
+		{
+			std::vector<Drawable*> drawables;
+			std::vector<Geometry*> meshes; // The mesh of the level of detail of every entry of the drawables
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> lodOffsets;
+			std::vector<Node*> nodes;
+			std::vector<uint8_t> visibility;
+			std::vector<Node*> visibleNodes;
+
+		public:
+			DrawList() = default;
+
+			void Clear()
+			{
+				drawables.clear();
+				meshes.clear();
+				offsets.assign(1, 0);
+				nodes.clear();
+			}
+
+			/**
+			 * \brief Fills the list with all the node/drawable pairs whose world bounds are inside of a frustum.
+			 * \param shapeList The drawables that should be checked
+			 * \param storage The storage holding the world bounds of the nodes, it must be up to date
+			 * \param frustum The frustum that should be used for culling
+			 * \param pool Optional worker pool to split the culling between multiple threads
+			 * \param occlusionCuller Optional occlusion culler that removes the nodes that are hidden behind occluders, its view projection must match the frustum
+			 * \param lodSelector Optional selector for the levels of detail of the drawables, without one the mesh of the drawables is used
+			 * \param pvsCell Optional cell of a potentially visible set, the nodes that are not visible from it are removed before the occlusion culling
+			 */
+			void Build(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, const Math::Frustum& frustum, WorkerPool* pool = nullptr,
+					   OcclusionCuller* occlusionCuller = nullptr, const LodSelector* lodSelector = nullptr, const PvsCell& pvsCell = PvsCell())
+			{
+				visibility.resize(storage.Size());
+				storage.Cull(frustum, visibility.data(), pool);
+				if (!pvsCell.IsEmpty())
+				{
+					for (uint32_t i = 0; i < visibility.size(); i++)
+					{
+						const Node* node = storage.GetNode(i);
+						if (visibility[i] && node) visibility[i] = pvsCell.IsVisible(node->GetStableId()) ? 1 : 0;
+					}
+				}
+				if (occlusionCuller) occlusionCuller->Cull(shapeList, storage, visibility.data(), pool);
+				Collect(shapeList, storage, lodSelector);
+			}
+
+			/**
+			 * \brief Fills the list like Build, but uses a spatial index to find the visible nodes instead of checking every node of the storage.
+			 * \param spatialIndex The spatial index of the storage, it must be up to date
+			 */
+			void Build(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, const ISpatialIndex& spatialIndex, const Math::Frustum& frustum,
+					   WorkerPool* pool = nullptr, OcclusionCuller* occlusionCuller = nullptr, const LodSelector* lodSelector = nullptr, const PvsCell& pvsCell = PvsCell())
+			{
+				visibility.assign(storage.Size(), 0);
+				visibleNodes.clear();
+				spatialIndex.QueryFrustum(frustum, visibleNodes);
+				const Math::BoundsArray& bounds = storage.GetWorldBounds();
+				for (const Node* node : visibleNodes)
+				{ // The spatial index only checks the frustum planes
+					const uint32_t index = node->GetTransformIndex();
+					visibility[index] = (pvsCell.IsVisible(node->GetStableId()) && frustum.IsContributing(bounds.GetCenter(index), bounds.GetExtent(index))) ? 1 : 0;
+				}
+				if (occlusionCuller) occlusionCuller->Cull(shapeList, storage, visibility.data(), pool);
+				Collect(shapeList, storage, lodSelector);
+			}
+
+			size_t GetDrawableCount() const
+			{
+				return drawables.size();
+			}
+
+			std::vector<Drawable*>& GetDrawables()
+			{
+				return drawables;
+			}
+
+			/**
+			 * \brief Gets the mesh that should be drawn for the nodes of an entry.
+			 */
+			Geometry* GetMesh(size_t drawableIndex) const
+			{
+				return meshes[drawableIndex];
+			}
+
+			Node* const* GetNodesBegin(size_t drawableIndex) const
+			{
+				return nodes.data() + offsets[drawableIndex];
+			}
+
+			Node* const* GetNodesEnd(size_t drawableIndex) const
+			{
+				return nodes.data() + offsets[drawableIndex + 1];
+			}
+
+			/**
+			 * \brief Gets the index of the first node of an entry in GetNodes.
+			 */
+			uint32_t GetFirstNode(size_t drawableIndex) const
+			{
+				return offsets[drawableIndex];
+			}
+
+			uint32_t GetNodeCount(size_t drawableIndex) const
+			{
+				return offsets[drawableIndex + 1] - offsets[drawableIndex];
+			}
+
+			/**
+			 * \brief Gets the nodes of all entries, ordered by entry.
+			 */
+			const std::vector<Node*>& GetNodes() const
+			{
+				return nodes;
+			}
+
+			/**
+			 * \brief Removes all the node/drawable pairs for which a predicate returns true, entries without any nodes left are removed as well.
+			 * \param predicate Called with the drawable, the mesh and the node of every pair
+			 */
+			template<typename PREDICATE>
+			void RemoveNodes(const PREDICATE& predicate)
+			{
+				size_t entryCount = 0, nodeCount = 0;
+				uint32_t begin = 0;
+				for (size_t i = 0; i < drawables.size(); i++)
+				{ // The offsets are compacted in place, so the end of the entry has to be read before it gets overwritten
+					const size_t start = nodeCount;
+					const uint32_t end = offsets[i + 1];
+					for (uint32_t j = begin; j < end; j++)
+					{
+						if (!predicate(drawables[i], meshes[i], nodes[j])) nodes[nodeCount++] = nodes[j];
+					}
+					begin = end;
+					if (nodeCount == start) continue;
+					drawables[entryCount] = drawables[i];
+					meshes[entryCount] = meshes[i];
+					offsets[++entryCount] = static_cast<uint32_t>(nodeCount);
+				}
+				drawables.resize(entryCount);
+				meshes.resize(entryCount);
+				offsets.resize(entryCount + 1);
+				nodes.resize(nodeCount);
+			}
+
+			/**
+			 * \brief Gets the amount of visible node/drawable pairs
+			 */
+			size_t GetVisibleCount() const
+			{
+				return nodes.size();
+			}
+
+		private:
+			/**
+			 * \brief Groups the visible nodes by their drawables, the visibility must have been filled for all the entries of the storage.
+			 */
+			void Collect(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, const LodSelector* lodSelector)
+			{
+				Clear();
+				for (Drawable* drawable : shapeList)
+				{
+					if (lodSelector && !drawable->lods.empty())
+					{
+						CollectLods(drawable, storage, *lodSelector);
+						continue;
+					}
+					const size_t start = nodes.size();
+					for (Node* node : drawable->nodes)
+					{ // Nodes that are not part of the storage can't be culled
+						if (IsVisible(node, storage)) nodes.push_back(node);
+					}
+					if (nodes.size() == start) continue;
+					drawables.push_back(drawable);
+					meshes.push_back(drawable->mesh);
+					offsets.push_back(static_cast<uint32_t>(nodes.size()));
+				}
+			}
+
+			/**
+			 * \brief Selects the levels of the visible nodes of a drawable and adds one entry for every used level (counting sort by level).
+			 */
+			void CollectLods(Drawable* drawable, const TransformStorage& storage, const LodSelector& lodSelector)
+			{
+				lodOffsets.assign(drawable->lods.size() + 2, 0);
+				for (size_t i = 0; i < drawable->nodes.size(); i++)
+				{
+					if (IsVisible(drawable->nodes[i], storage)) lodOffsets[lodSelector.Select(*drawable, i) + 1]++;
+				}
+				const size_t start = nodes.size();
+				for (size_t level = 0; level <= drawable->lods.size(); level++)
+				{
+					const uint32_t count = lodOffsets[level + 1];
+					lodOffsets[level + 1] = lodOffsets[level] + count;
+					lodOffsets[level] += static_cast<uint32_t>(start);
+					if (!count) continue;
+					drawables.push_back(drawable);
+					meshes.push_back(drawable->GetLodMesh(static_cast<uint32_t>(level)));
+					offsets.push_back(static_cast<uint32_t>(start) + lodOffsets[level + 1]);
+				}
+				nodes.resize(offsets.back());
+				for (size_t i = 0; i < drawable->nodes.size(); i++)
+				{
+					if (IsVisible(drawable->nodes[i], storage)) nodes[lodOffsets[drawable->nodeLods[i]]++] = drawable->nodes[i];
+				}
+			}
+
+			bool IsVisible(const Node* node, const TransformStorage& storage) const
+			{
+				return node->GetTransformStorage() != &storage || visibility[node->GetTransformIndex()];
+			}
+		};
+	}
+}
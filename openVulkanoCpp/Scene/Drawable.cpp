@@ -5,6 +5,11 @@ namespace openVulkanoCpp
 {
 	namespace Scene
 	{
+		Drawable* Drawable::Copy(Scene* scene) const
+		{
+			return scene ? scene->CreateDrawable(this) : Copy();
+		}
+
 		void Drawable::SetScene(Scene* scene)
 		{
 			if (this->scene == scene) return;
@@ -13,12 +18,32 @@ namespace openVulkanoCpp
 			if(scene) scene->RegisterDrawable(this);
 		}
 
-		void Drawable::RemoveNode(Node* node)
+		uint32_t Drawable::AddNode(Node* node, uint32_t drawableSlot)
+		{
+			if (!mesh) throw std::runtime_error("Drawable is not initialized.");
+			// Only the drawables of the node need to be checked, they are usually far less than the nodes of the drawable
+			if (Utils::Contains(node->drawables, this)) throw std::runtime_error("A drawable must not use the same node more than once.");
+			nodes.push_back(node);
+			nodeSlots.push_back(drawableSlot);
+			nodeLods.push_back(0);
+			return static_cast<uint32_t>(nodes.size() - 1);
+		}
+
+		void Drawable::RemoveNode(uint32_t nodeSlot)
 		{
-			Utils::Remove(nodes, node);
-			if (nodes.empty())
+			const uint32_t last = static_cast<uint32_t>(nodes.size() - 1);
+			if (nodeSlot != last)
+			{
+				nodes[nodeSlot] = nodes[last];
+				nodeSlots[nodeSlot] = nodeSlots[last];
+				nodeLods[nodeSlot] = nodeLods[last];
+				nodes[nodeSlot]->drawableSlots[nodeSlots[nodeSlot]] = nodeSlot;
+			}
+			nodes.pop_back();
+			nodeSlots.pop_back();
+			nodeLods.pop_back();
+			if (nodes.empty() && scene)
 			{
-				scene = nullptr;
 				scene->RemoveDrawable(this);
 			}
 		}
@@ -11,12 +11,28 @@ namespace openVulkanoCpp
 		class Node;
 		class Scene;
 
+		/**
+		 * \brief A simplified version of the mesh of a drawable.
+		 */
+		struct LodLevel
+		{
+			Geometry* mesh = nullptr;
+			float screenSize = 0; // The level is used once the projected size of a node gets smaller than this fraction of the screen height
+		};
+
 		struct Drawable : virtual public ICloseable
 		{
+			static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
 			std::vector<Node*> nodes;
+			std::vector<uint32_t> nodeSlots; // The index of the drawable inside the drawables of the node with the same index
+			uint32_t sceneIndex = INVALID_SLOT; // The index of the drawable inside the shape list of its scene
 			Scene* scene = nullptr;
 			Geometry* mesh = nullptr;
 			Material* material = nullptr;
+			Geometry* occluder = nullptr; // Optional simplified geometry that hides other nodes during occlusion culling, it must not exceed the mesh
+			std::vector<LodLevel> lods; // The coarser versions of the mesh, sorted from fine to coarse
+			std::vector<uint8_t> nodeLods; // The level that has been selected for the node with the same index, 0 is the mesh
 
 		public:
 			Drawable() = default;
@@ -25,6 +41,8 @@ namespace openVulkanoCpp
 			{
 				mesh = toCopy->mesh;
 				material = toCopy->material;
+				occluder = toCopy->occluder;
+				lods = toCopy->lods;
 			}
 
 			virtual ~Drawable()
@@ -37,6 +55,11 @@ namespace openVulkanoCpp
 				return new Drawable(this);
 			}
 
+			/**
+			 * \brief Creates a copy of the drawable inside the drawable pool of a scene.
+			 */
+			Drawable* Copy(Scene* scene) const;
+
 			void Init(Geometry* mesh, Material* material)
 			{
 				if (this->mesh || this->material) throw std::runtime_error("Drawable is already initialized.");
@@ -49,6 +72,32 @@ namespace openVulkanoCpp
 				if (mesh || material) throw std::runtime_error("Drawable is already initialized.");
 				this->mesh = drawable->mesh;
 				this->material = drawable->material;
+				this->occluder = drawable->occluder;
+				this->lods = drawable->lods;
+			}
+
+			/**
+			 * \brief Adds a coarser level of detail, the levels must be added from fine to coarse.
+			 * \param mesh The simplified mesh, e.g. created with the MeshSimplifier
+			 * \param screenSize The level is used once the projected size of a node gets smaller than this fraction of the screen height,
+			 * it must be smaller than the one of the previous level
+			 */
+			void AddLod(Geometry* mesh, float screenSize)
+			{
+				if (lods.size() >= UINT8_MAX) throw std::runtime_error("Too many lod levels.");
+				if (!lods.empty() && screenSize >= lods.back().screenSize) throw std::runtime_error("The lod levels must be added from fine to coarse.");
+				LodLevel level;
+				level.mesh = mesh;
+				level.screenSize = screenSize;
+				lods.push_back(level);
+			}
+
+			/**
+			 * \brief Gets the mesh of a level of detail, level 0 is the mesh of the drawable.
+			 */
+			Geometry* GetLodMesh(uint32_t level) const
+			{
+				return level ? lods[level - 1].mesh : mesh;
 			}
 
 			void Close() override
@@ -56,6 +105,8 @@ namespace openVulkanoCpp
 				if (!nodes.empty()) throw std::runtime_error("Drawable is still being used!!!");
 				mesh = nullptr;
 				material = nullptr;
+				occluder = nullptr;
+				lods.clear();
 			}
 
 			Scene* GetScene() const
@@ -67,16 +118,21 @@ namespace openVulkanoCpp
 			friend class Node;
 			friend class Scene;
 
-			void AddNode(Node* node)
-			{
-				if (!mesh) throw std::runtime_error("Drawable is not initialized.");
-				if (Utils::Contains(nodes, node)) throw std::runtime_error("A drawable must not use the same node more than once.");
-				nodes.push_back(node);
-			}
+			/**
+			 * \brief Adds a node to the drawable.
+			 * \param node The node to add
+			 * \param drawableSlot The index of the drawable inside the drawables of the node
+			 * \return The index of the node inside the nodes of the drawable
+			 */
+			uint32_t AddNode(Node* node, uint32_t drawableSlot);
 
 			void SetScene(Scene* scene);
 
-			void RemoveNode(Node* node);
+			/**
+			 * \brief Removes a node by swapping it with the last one.
+			 * \param nodeSlot The index of the node inside the nodes of the drawable
+			 */
+			void RemoveNode(uint32_t nodeSlot);
 		};
 	}
 }
@@ -34,6 +34,7 @@ namespace openVulkanoCpp
 			uint32_t* GetIndices32() const { return static_cast<uint32_t*>(indices); }
 			uint32_t GetIndexCount() const { return indexCount; }
 			uint32_t GetVertexCount() const { return vertexCount; }
+			uint32_t GetIndex(uint32_t i) const { return (indexType == VertexIndexType::UINT16) ? GetIndices16()[i] : GetIndices32()[i]; }
 
 			static Geometry* LoadFromFile(const std::string file)
 			{
@@ -131,6 +132,8 @@ namespace openVulkanoCpp
 					20, 21, 22, 20, 22, 23	// right face index data
 					}, indexCount);
 				x *= 0.5f; y *= 0.5f; z *= 0.5f;
+				aabb.Init(glm::vec3(-x, -y, -z));
+				aabb.Grow(glm::vec3(x, y, z));
 				int i = 0;
 				// front face vertex data
 				vertices[i++].Set(-x, +y, -z, +0, +0, -1, +0, +0);
@@ -190,7 +193,7 @@ namespace openVulkanoCpp
 				vertexCount = 0;
 				indexCount = 0;
 				Free();
-				renderGeo->Close();
+				if (renderGeo) renderGeo->Close();
 				renderGeo = nullptr;
 			}
 
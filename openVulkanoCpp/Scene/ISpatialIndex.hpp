@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "AABB.hpp"
+#include "../Math/Frustum.hpp"
+#include "../Math/Ray.hpp"
+#include "../Base/WorkerPool.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		struct Node;
+
+		enum class SpatialIndexType
+		{
+			None, Bvh, HashGrid
+		};
+
+		struct RayHit
+		{
+			Node* node;
+			float distance; // The distance at which the ray enters the world bounds of the node
+		};
+
+		/**
+		 * \brief A spatial index over the world bounds of the nodes of a scene. Only nodes with drawables are part of the index.
+		 * The index is kept up to date by the transform storage of the scene, the queries append their results to the given vectors.
+		 */
+		class ISpatialIndex
+		{
+		public:
+			static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+			virtual ~ISpatialIndex() = default;
+
+			/**
+			 * \brief Adds, moves or removes nodes whose world bounds, drawables or update frequency have been changed.
+			 * \param nodes The changed nodes, they must be part of the transform storage of the scene
+			 * \param count The amount of nodes
+			 * \param pool Optional worker pool that can be used to process the nodes in parallel
+			 */
+			virtual void Update(Node* const* nodes, size_t count, WorkerPool* pool = nullptr) = 0;
+
+			/**
+			 * \brief Removes a node from the index, nodes that are not part of the index will be ignored.
+			 */
+			virtual void Remove(Node* node) = 0;
+
+			/**
+			 * \brief Removes all the nodes from the index.
+			 */
+			virtual void Clear() = 0;
+
+			virtual size_t Size() const = 0;
+
+			/**
+			 * \brief Finds all the nodes whose world bounds are at least partially inside of a frustum.
+			 */
+			virtual void QueryFrustum(const Math::Frustum& frustum, std::vector<Node*>& result) const = 0;
+
+			/**
+			 * \brief Finds all the nodes whose world bounds are overlapping with a box.
+			 */
+			virtual void QueryAABB(const AABB& bounds, std::vector<Node*>& result) const = 0;
+
+			/**
+			 * \brief Visits the nodes whose world bounds are hit by a ray, roughly ordered from near to far.
+			 * \param ray The ray
+			 * \param maxDistance Nodes that are entered further away will be skipped
+			 * \param visitor Receives every hit node and the distance at which the ray enters its bounds.
+			 * It returns the new maximum distance, so the traversal can stop as soon as the closest hit has been found.
+			 */
+			virtual void TraverseRay(const Math::Ray& ray, float maxDistance, const std::function<float(Node*, float)>& visitor) const = 0;
+
+			/**
+			 * \brief Finds all the nodes whose world bounds are hit by a ray. The hits are not sorted.
+			 */
+			void QueryRay(const Math::Ray& ray, float maxDistance, std::vector<RayHit>& result) const
+			{
+				TraverseRay(ray, maxDistance, [&](Node* node, float distance)
+				{
+					result.push_back({ node, distance });
+					return maxDistance;
+				});
+			}
+		};
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Camera.hpp"
+#include "Drawable.hpp"
+#include "TransformStorage.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Selects the levels of detail of the node/drawable pairs from the projected size of the world bounds of the nodes.
+		 * The projected size is the diameter of the bounding sphere of the bounds as a fraction of the screen height.
+		 * A level is only left once the size moved past its threshold by the hysteresis, so nodes close to a threshold don't flicker between two levels.
+		 */
+		class LodSelector final
+		{
+			glm::vec3 cameraPosition;
+			float projectionScale; // The screen height of one world unit at a distance of one, or at any distance for orthographic cameras
+			bool perspective;
+			float hysteresis;
+
+		public:
+			static constexpr float DEFAULT_HYSTERESIS = 0.1f;
+
+			/**
+			 * \param camera The camera the scene is rendered with, its view matrix must be up to date
+			 * \param hysteresis The fraction of a threshold the projected size has to move past it before the level changes
+			 */
+			explicit LodSelector(const Camera& camera, float hysteresis = DEFAULT_HYSTERESIS)
+				: cameraPosition(glm::inverse(camera.view)[3]), projectionScale(camera.projection[1][1] * 0.5f),
+				  perspective(camera.projection[3][3] == 0), hysteresis(hysteresis)
+			{}
+
+			/**
+			 * \brief Calculates the projected size of a world space box as a fraction of the screen height.
+			 */
+			float GetScreenSize(const glm::vec3& center, const glm::vec3& extent) const
+			{
+				const float diameter = 2 * glm::length(extent);
+				if (!perspective) return diameter * projectionScale;
+				const float distance = glm::length(center - cameraPosition);
+				if (distance <= diameter * 0.5f) return INFINITY; // The camera is inside of the bounding sphere
+				return diameter * projectionScale / distance;
+			}
+
+			/**
+			 * \brief Selects the level for a projected size, starting from the level that has been used before.
+			 * \return The new level, 0 is the mesh of the drawable
+			 */
+			uint8_t SelectLevel(const Drawable& drawable, float screenSize, uint8_t current) const
+			{
+				const size_t levelCount = drawable.lods.size();
+				size_t level = std::min<size_t>(current, levelCount);
+				// lods[i] is the threshold of the level i + 1
+				while (level < levelCount && screenSize < drawable.lods[level].screenSize * (1 - hysteresis)) level++;
+				while (level > 0 && screenSize >= drawable.lods[level - 1].screenSize * (1 + hysteresis)) level--;
+				return static_cast<uint8_t>(level);
+			}
+
+			/**
+			 * \brief Updates the selected level of a node of a drawable.
+			 * \param nodeIndex The index of the node inside the nodes of the drawable
+			 * \return The new level
+			 */
+			uint8_t Select(Drawable& drawable, size_t nodeIndex) const
+			{
+				const Node* node = drawable.nodes[nodeIndex];
+				const Math::BoundsArray& bounds = node->GetTransformStorage()->GetWorldBounds();
+				const uint32_t index = node->GetTransformIndex();
+				uint8_t& level = drawable.nodeLods[nodeIndex];
+				level = SelectLevel(drawable, GetScreenSize(bounds.GetCenter(index), bounds.GetExtent(index)), level);
+				return level;
+			}
+		};
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "Geometry.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Creates simplified versions of triangle meshes by vertex clustering.
+		 * The bounds of the mesh are split into a uniform grid, all vertices inside of a cell are merged into their average
+		 * and the triangles that collapse are removed. It is fast and robust, but does not preserve sharp features.
+		 */
+		class MeshSimplifier final
+		{
+			struct Cluster
+			{
+				glm::vec3 position = glm::vec3(0), normal = glm::vec3(0), tangent = glm::vec3(0), biTangent = glm::vec3(0), textureCoordinates = glm::vec3(0);
+				glm::vec4 color = glm::vec4(0);
+				uint32_t count = 0;
+			};
+
+		public:
+			/**
+			 * \brief Fills a geometry with a simplified version of another one.
+			 * \param source The triangle list that should be simplified
+			 * \param target The uninitialized geometry that receives the result
+			 * \param gridResolution The amount of cells along the longest axis of the bounds of the source
+			 */
+			static void Simplify(const Geometry& source, Geometry& target, uint32_t gridResolution)
+			{
+				glm::vec3 min(INFINITY), max(-INFINITY); // The bounds of a geometry are not always set, so they are calculated from the vertices
+				for (uint32_t i = 0; i < source.GetVertexCount(); i++)
+				{
+					min = glm::min(min, source.vertices[i].position);
+					max = glm::max(max, source.vertices[i].position);
+				}
+				const glm::vec3 size = glm::max(max - min, glm::vec3(0));
+				const float cellSize = std::max(std::max(std::max(size.x, size.y), size.z), 1e-6f) / static_cast<float>(std::max(gridResolution, 1u));
+				const glm::uvec3 cells = glm::uvec3(glm::floor(size / cellSize)) + 1u;
+				std::unordered_map<uint64_t, uint32_t> cellClusters;
+				std::vector<Cluster> clusters;
+				std::vector<uint32_t> vertexClusters(source.GetVertexCount());
+				for (uint32_t i = 0; i < source.GetVertexCount(); i++)
+				{
+					const Vertex& vertex = source.vertices[i];
+					const glm::uvec3 cell = glm::min(glm::uvec3(glm::max((vertex.position - min) / cellSize, glm::vec3(0))), cells - 1u);
+					const uint64_t key = (static_cast<uint64_t>(cell.z) * cells.y + cell.y) * cells.x + cell.x;
+					const auto inserted = cellClusters.emplace(key, static_cast<uint32_t>(clusters.size()));
+					if (inserted.second) clusters.emplace_back();
+					Cluster& cluster = clusters[inserted.first->second];
+					cluster.position += vertex.position;
+					cluster.normal += vertex.normal;
+					cluster.tangent += vertex.tangent;
+					cluster.biTangent += vertex.biTangent;
+					cluster.textureCoordinates += vertex.textureCoordinates;
+					cluster.color += vertex.color;
+					cluster.count++;
+					vertexClusters[i] = inserted.first->second;
+				}
+
+				std::vector<uint32_t> indices;
+				indices.reserve(source.GetIndexCount());
+				for (uint32_t i = 0; i + 2 < source.GetIndexCount(); i += 3)
+				{
+					const uint32_t a = vertexClusters[source.GetIndex(i)], b = vertexClusters[source.GetIndex(i + 1)], c = vertexClusters[source.GetIndex(i + 2)];
+					if (a == b || b == c || a == c) continue; // The triangle collapsed
+					indices.push_back(a);
+					indices.push_back(b);
+					indices.push_back(c);
+				}
+
+				target.Init(static_cast<uint32_t>(clusters.size()), static_cast<uint32_t>(indices.size()));
+				target.aabb.Init();
+				for (size_t i = 0; i < clusters.size(); i++)
+				{
+					const Cluster& cluster = clusters[i];
+					const float weight = 1.0f / static_cast<float>(cluster.count);
+					Vertex& vertex = target.vertices[i];
+					vertex.position = cluster.position * weight;
+					vertex.normal = SafeNormalize(cluster.normal);
+					vertex.tangent = SafeNormalize(cluster.tangent);
+					vertex.biTangent = SafeNormalize(cluster.biTangent);
+					vertex.textureCoordinates = cluster.textureCoordinates * weight;
+					vertex.color = cluster.color * weight;
+					target.aabb.Grow(vertex.position);
+				}
+				target.SetIndices(indices.data(), target.GetIndexCount());
+			}
+
+			/**
+			 * \brief Creates a chain of simplified versions of a geometry, every level uses half of the grid resolution of the previous one.
+			 * Levels that would not remove any triangles compared to the previous one are skipped.
+			 * \param source The geometry to simplify
+			 * \param levelCount The maximum amount of levels to create
+			 * \param gridResolution The grid resolution of the first level
+			 * \return The new geometries from fine to coarse, they are owned by the caller
+			 */
+			static std::vector<Geometry*> CreateLodChain(const Geometry& source, uint32_t levelCount, uint32_t gridResolution = 32)
+			{
+				std::vector<Geometry*> chain;
+				uint32_t lastIndexCount = source.GetIndexCount();
+				for (uint32_t level = 0; level < levelCount && gridResolution > 0; level++, gridResolution /= 2)
+				{
+					Geometry* geometry = new Geometry();
+					Simplify(source, *geometry, gridResolution);
+					if (geometry->GetIndexCount() == 0 || geometry->GetIndexCount() >= lastIndexCount)
+					{
+						delete geometry;
+						continue;
+					}
+					lastIndexCount = geometry->GetIndexCount();
+					chain.push_back(geometry);
+				}
+				return chain;
+			}
+
+			/**
+			 * \brief Loads the first mesh of a file like Geometry::LoadFromFile and creates its chain of simplified versions.
+			 * \param lods Receives the simplified geometries from fine to coarse, they are owned by the caller
+			 * \return The loaded geometry, it is owned by the caller
+			 */
+			static Geometry* LoadFromFile(const std::string& file, std::vector<Geometry*>& lods, uint32_t levelCount, uint32_t gridResolution = 32)
+			{
+				Geometry* mesh = Geometry::LoadFromFile(file);
+				lods = CreateLodChain(*mesh, levelCount, gridResolution);
+				return mesh;
+			}
+
+		private:
+			static glm::vec3 SafeNormalize(const glm::vec3& vector)
+			{
+				const float length = glm::length(vector);
+				return (length > 0) ? vector / length : vector;
+			}
+		};
+	}
+}
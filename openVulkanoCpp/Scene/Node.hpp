@@ -6,6 +6,7 @@
 #include "../Base/IInitable.hpp"
 #include "../Base/ICloseable.hpp"
 #include "Drawable.hpp"
+#include "TransformStorage.hpp"
 
 namespace openVulkanoCpp
 {
@@ -21,56 +22,73 @@ namespace openVulkanoCpp
 		struct Node : virtual IInitable, virtual ICloseable
 		{
 			friend Scene;
+			friend TransformStorage;
 		protected:
 			static const glm::mat4x4 IDENTITY;
 		public:
-			glm::mat4x4 localMat, worldMat;
 			bool enabled = true;
+			TransformStorage* transforms = nullptr;
+			uint32_t transformIndex = TransformStorage::INVALID_INDEX;
 			Node* parent = nullptr;
 			Scene* scene = nullptr;
 			std::vector<Node*> children;
 			std::vector<Drawable*> drawables;
+			std::vector<uint32_t> drawableSlots; // The index of the node inside the nodes of the drawable with the same index
+			uint32_t childIndex = 0; // The index of the node inside the children of its parent
+			uint32_t spatialIndexSlot = ISpatialIndex::INVALID_SLOT; // Managed by the spatial index of the scene
+			uint32_t stableId = TransformStorage::INVALID_INDEX;
+			const TransformStorage* stableIdOwner = nullptr; // The storage that handed out the stable id
 			UpdateFrequency matrixUpdateFrequency = UpdateFrequency::Never;
-			ICloseable* renderNode = nullptr;
 
 		public:
 			Node() = default;
-			virtual ~Node() = default;
+
+			virtual ~Node()
+			{
+				ReleaseTransform();
+			}
 
 			void Init() override
 			{
 				if (parent || scene || !children.empty() || !drawables.empty()) throw std::runtime_error("Node already initialized");
-				localMat = worldMat = IDENTITY;
+				ReleaseTransform();
+				stableId = TransformStorage::INVALID_INDEX;
+				stableIdOwner = nullptr;
+				transforms = TransformStorage::GetDetachedStorage();
+				transformIndex = transforms->Add(this, TransformStorage::INVALID_INDEX, IDENTITY);
 				enabled = true;
 				parent = nullptr;
 				children = std::vector<Node*>();
 				drawables = std::vector<Drawable*>();
+				drawableSlots = std::vector<uint32_t>();
 			}
 
 			void Close() override
 			{
-				children.clear();
-				if (renderNode) renderNode->Close();
-				parent = nullptr;
-				scene = nullptr;
-				enabled = false;
 				if (!children.empty()) Logger::SCENE->warn("Closing Node that has children!");
 				for (Node* child : children)
 				{
 					child->SetParent(nullptr);
+					child->MoveTransform(TransformStorage::GetDetachedStorage(), TransformStorage::INVALID_INDEX);
 				}
 				children.clear();
-				for(size_t i = drawables.size(); i > 0; i--)
+				for (size_t i = drawables.size(); i > 0; i--)
 				{
-					RemoveDrawable(drawables[i]);
+					RemoveDrawableAt(static_cast<uint32_t>(i - 1));
 				}
+				if (parent && parent != this) parent->RemoveChildAt(childIndex);
+				parent = nullptr;
+				scene = nullptr;
+				enabled = false;
+				ReleaseTransform();
 			}
 
 			void AddChild(Node* node)
 			{
 				node->SetParent(this);
+				node->childIndex = static_cast<uint32_t>(children.size());
 				children.push_back(node);
-				node->UpdateWorldMatrix(worldMat);
+				node->MoveTransform(transforms, transformIndex);
 			}
 
 			void AddChild(Drawable* drawable)
@@ -80,10 +98,11 @@ namespace openVulkanoCpp
 
 			void RemoveChild(Node* node)
 			{
-				if (node->parent == this)
+				if (node->parent == this && node != this)
 				{
-					Utils::Remove(children, node);
+					RemoveChildAt(node->childIndex);
 					node->SetParent(nullptr);
+					node->MoveTransform(TransformStorage::GetDetachedStorage(), TransformStorage::INVALID_INDEX);
 				}
 			}
 
@@ -96,30 +115,102 @@ namespace openVulkanoCpp
 			{
 				if (scene) drawable->SetScene(scene);
 				else if (drawable->GetScene()) Logger::SCENE->warn("Drawable is already associated with a scene, but the node it was added to is not!");
-				drawable->AddNode(this);
+				const uint32_t nodeSlot = drawable->AddNode(this, static_cast<uint32_t>(drawables.size()));
 				drawables.push_back(drawable);
+				drawableSlots.push_back(nodeSlot);
+				UpdateLocalBounds();
 			}
 
 			void RemoveDrawable(Drawable* drawable)
-			{
-				drawable->RemoveNode(this);
-				Utils::Remove(drawables, drawable);
+			{ // A node only has a few drawables, the drawable side (which might be used by thousands of nodes) is accessed through the slot
+				const auto it = std::find(drawables.begin(), drawables.end(), drawable);
+				if (it != drawables.end()) RemoveDrawableAt(static_cast<uint32_t>(it - drawables.begin()));
 			}
 
-			void SetMatrix(glm::mat4x4 mat)
+			/**
+			 * \brief Sets the local matrix of the node. The world matrix will not be updated immediately,
+			 * it will be recalculated by Scene::UpdateWorldMatrices or when it is requested with GetWorldMatrix.
+			 * \param mat The new local matrix
+			 */
+			void SetMatrix(const glm::mat4x4& mat)
 			{
-				localMat = mat;
-				UpdateWorldMatrix(parent ? parent->GetWorldMatrix() : IDENTITY);
+				transforms->SetLocalMatrix(transformIndex, mat);
 			}
 
 			const glm::mat4x4& GetMatrix() const
 			{
-				return localMat;
+				return transforms->GetLocalMatrix(transformIndex);
+			}
+
+			/**
+			 * \brief Sets the position of the node. The node will switch to a compact transformation (position, rotation and uniform scale),
+			 * its local matrix will be composed lazily. A local matrix set with SetMatrix will be decomposed first.
+			 */
+			void SetPosition(const glm::vec3& position)
+			{
+				transforms->SetPosition(transformIndex, position);
+			}
+
+			void SetRotation(const glm::quat& rotation)
+			{
+				transforms->SetRotation(transformIndex, rotation);
+			}
+
+			void SetScale(float scale)
+			{
+				transforms->SetScale(transformIndex, scale);
+			}
+
+			const glm::vec3& GetPosition() const
+			{
+				return transforms->GetTrs(transformIndex).position;
+			}
+
+			const glm::quat& GetRotation() const
+			{
+				return transforms->GetTrs(transformIndex).rotation;
+			}
+
+			float GetScale() const
+			{
+				return transforms->GetTrs(transformIndex).scale;
+			}
+
+			/**
+			 * \brief Gets the world matrix of the node. If the node or one of its parents has been changed it will be recalculated first.
+			 * \return The up to date world matrix of the node
+			 */
+			const glm::mat4x4& GetWorldMatrix()
+			{
+				return transforms->GetWorldMatrix(transformIndex);
 			}
 
-			const glm::mat4x4& GetWorldMatrix() const
+			bool IsWorldMatrixDirty() const
 			{
-				return worldMat;
+				return transforms->IsDirty(transformIndex);
+			}
+
+			TransformStorage* GetTransformStorage() const
+			{
+				return transforms;
+			}
+
+			/**
+			 * \brief Gets the index of the node inside its transform storage. The index will change if the storage gets compacted or the node gets moved to another parent.
+			 */
+			uint32_t GetTransformIndex() const
+			{
+				return transformIndex;
+			}
+
+			/**
+			 * \brief Gets the id the node got when it was added to its scene for the first time. It is kept while the node is sorted or moved to another parent
+			 * inside of the same scene. The ids are handed out in the order the nodes are added, so a scene that is built in the same order gets the same ids.
+			 * \return The id or INVALID_INDEX if the node has never been part of a scene
+			 */
+			uint32_t GetStableId() const
+			{
+				return stableId;
 			}
 
 			bool IsEnabled() const
@@ -161,19 +252,83 @@ namespace openVulkanoCpp
 			{
 				if (!children.empty()) throw std::runtime_error("The update must not be changed for nodes with children.");
 				this->matrixUpdateFrequency = frequency;
+				if (transforms) transforms->Invalidate(transformIndex); // The spatial index might store the node depending on its update frequency
 			}
 
-		protected:
-			virtual void UpdateWorldMatrix(const glm::mat4x4& parentWorldMat)
+		private:
+			void RemoveChildAt(uint32_t index)
 			{
-				worldMat = parentWorldMat * localMat;
-				for (const auto& node : children)
+				children[index] = children.back();
+				children[index]->childIndex = index;
+				children.pop_back();
+			}
+
+			void RemoveDrawableAt(uint32_t index)
+			{
+				Drawable* drawable = drawables[index];
+				const uint32_t nodeSlot = drawableSlots[index];
+				const uint32_t last = static_cast<uint32_t>(drawables.size() - 1);
+				if (index != last)
 				{
-					node->UpdateWorldMatrix(worldMat);
+					drawables[index] = drawables[last];
+					drawableSlots[index] = drawableSlots[last];
+					drawables[index]->nodeSlots[drawableSlots[index]] = index;
 				}
+				drawables.pop_back();
+				drawableSlots.pop_back();
+				drawable->RemoveNode(nodeSlot);
+				UpdateLocalBounds();
+			}
+
+			/**
+			 * \brief Recalculates the local bounds of the node from the geometries of its drawables.
+			 */
+			void UpdateLocalBounds()
+			{
+				if (!transforms) return;
+				AABB bounds;
+				for (Drawable* drawable : drawables)
+				{
+					if (drawable->mesh) bounds.Grow(drawable->mesh->aabb);
+				}
+				transforms->SetLocalBounds(transformIndex, bounds);
+			}
+
+			/**
+			 * \brief Moves the transformation of the node and all its children into a storage. The children will be appended after their parent.
+			 * \param target The storage the transformations should be moved to
+			 * \param parentIndex The index of the new parent inside the target storage
+			 */
+			void MoveTransform(TransformStorage* target, uint32_t parentIndex)
+			{
+				const glm::mat4x4 localMat = transforms->GetLocalMatrix(transformIndex);
+				const bool usesTrs = transforms->UsesTrs(transformIndex);
+				const TransformStorage::Trs trs = usesTrs ? transforms->GetTrs(transformIndex) : TransformStorage::Trs();
+				const glm::vec3 boundsCenter = transforms->GetLocalBoundsCenter(transformIndex), boundsExtent = transforms->GetLocalBoundsExtent(transformIndex);
+				transforms->Remove(transformIndex);
+				transforms = target;
+				transformIndex = target->Add(this, parentIndex, localMat);
+				if (target != TransformStorage::GetDetachedStorage() && stableIdOwner != target)
+				{
+					stableId = target->AllocateStableId();
+					stableIdOwner = target;
+				}
+				if (usesTrs) target->SetTrs(transformIndex, trs);
+				target->SetLocalBounds(transformIndex, boundsCenter, boundsExtent);
+				for (Node* child : children)
+				{
+					child->MoveTransform(target, transformIndex);
+				}
+			}
+
+			void ReleaseTransform()
+			{
+				if (!transforms) return;
+				transforms->Remove(transformIndex);
+				transforms = nullptr;
+				transformIndex = TransformStorage::INVALID_INDEX;
 			}
 
-		private:
 			void SetParent(Node* parent)
 			{
 				if (this->parent && parent) throw std::runtime_error("Node already has a parent! Nodes must not be used multiple times!");
@@ -200,7 +355,10 @@ namespace openVulkanoCpp
 							if(drawableScene != scene)
 							{
 								Logger::SCENE->warn("Drawable is already associated with a scene! Creating copy.");
-								drawables[i] = drawables[i]->Copy();
+								Drawable* copy = drawables[i]->Copy(scene);
+								drawables[i]->RemoveNode(drawableSlots[i]);
+								drawables[i] = copy;
+								drawableSlots[i] = copy->AddNode(this, static_cast<uint32_t>(i));
 							}
 						}
 						drawables[i]->SetScene(scene);
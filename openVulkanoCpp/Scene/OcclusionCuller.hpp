@@ -0,0 +1,503 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <glm/glm.hpp>
+#include "Node.hpp"
+#include "../Math/MatrixBatch.hpp"
+#include "../Data/AlignedAllocator.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Culls nodes that are hidden behind occluders using a low resolution depth buffer that is rasterized on the cpu.
+		 * The occluder geometries of the drawables are rasterized for all their nodes that passed the frustum culling,
+		 * afterwards the world bounds of the visible nodes are tested against a hierarchical maximum depth version of the buffer.
+		 * The buffer is split into horizontal bands that are rasterized in parallel, the rows are rasterized with the simd kernel selected by the MatrixBatch.
+		 */
+		class OcclusionCuller final
+		{
+			static constexpr uint32_t BAND_HEIGHT = 16;
+			static constexpr uint32_t MIN_TEST_CHUNK_SIZE = 1024;
+			static constexpr int32_t MAX_TEST_TEXELS = 4; // The maximum amount of texels per axis that are checked for a box
+
+			/**
+			 * \brief A screen space triangle, the edge functions and the depth plane are evaluated at the pixel centers.
+			 * All three edge functions are positive inside of the triangle.
+			 */
+			struct Triangle
+			{
+				float edgeA[3], edgeB[3], edgeC[3];
+				float depthA, depthB, depthC;
+				int32_t minX, maxX, minY, maxY;
+			};
+
+			typedef std::vector<float, Data::AlignedAllocator<float, 64>> DepthArray;
+
+			uint32_t width = 0, height = 0, bandCount = 0;
+			glm::mat4x4 viewProjection = glm::mat4x4(1);
+			std::vector<DepthArray> levels; // The first level is the depth buffer, every following one stores the maximum of 2x2 texels of the previous one
+			std::vector<uint32_t> levelWidths, levelHeights;
+			std::vector<Node*> occluderNodes;
+			std::vector<const Geometry*> occluderMeshes;
+			std::vector<std::vector<Triangle>> triangles; // The triangles of every thread
+			std::vector<std::vector<std::vector<uint32_t>>> bins; // The triangles of every thread that overlap a band
+			std::atomic<uint32_t> nextBand;
+			std::atomic<size_t> occludedCount;
+			size_t triangleCount = 0;
+
+		public:
+			OcclusionCuller() : nextBand(0), occludedCount(0)
+			{}
+
+			explicit OcclusionCuller(uint32_t width, uint32_t height) : OcclusionCuller()
+			{
+				Init(width, height);
+			}
+
+			/**
+			 * \brief Creates the depth buffer and its hierarchy.
+			 * \param width The width of the depth buffer in pixels, it will be rounded up to a multiple of 8 for the simd kernels
+			 * \param height The height of the depth buffer in pixels
+			 */
+			void Init(uint32_t width, uint32_t height)
+			{
+				if (!width || !height) throw std::runtime_error("The occlusion depth buffer must not be empty.");
+				this->width = (width + 7) & ~7u;
+				this->height = height;
+				bandCount = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+				levels.clear();
+				levelWidths.clear();
+				levelHeights.clear();
+				uint32_t levelWidth = this->width, levelHeight = height;
+				while (true)
+				{
+					levels.emplace_back(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+					levelWidths.push_back(levelWidth);
+					levelHeights.push_back(levelHeight);
+					if (levelWidth == 1 && levelHeight == 1) break;
+					levelWidth = (levelWidth + 1) / 2;
+					levelHeight = (levelHeight + 1) / 2;
+				}
+			}
+
+			/**
+			 * \brief Sets the view projection matrix (with a depth range of [0, 1]) that is used for the next Cull.
+			 */
+			void SetViewProjection(const glm::mat4x4& viewProjection)
+			{
+				this->viewProjection = viewProjection;
+			}
+
+			/**
+			 * \brief Rasterizes the occluders and marks all the nodes that are hidden behind them as invisible.
+			 * \param shapeList The drawables of the scene, the ones with an occluder geometry will be rasterized
+			 * \param storage The storage holding the world matrices and bounds of the nodes, it must be up to date
+			 * \param visibility The result of the frustum culling with one entry per entry of the storage, hidden nodes will be set to 0
+			 * \param pool Optional worker pool to split the rasterization and the tests between multiple threads
+			 */
+			void Cull(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, uint8_t* visibility, WorkerPool* pool = nullptr)
+			{
+				RenderOccluders(shapeList, storage, visibility, pool);
+				if (triangleCount) TestBounds(storage, visibility, pool);
+			}
+
+			/**
+			 * \brief Rasterizes the occluders and builds the depth hierarchy without testing any nodes against it.
+			 * This is used when the tests are done somewhere else, e.g. on the gpu.
+			 * \param visibility The result of the frustum culling with one entry per entry of the storage, nullptr to rasterize the occluders of all nodes
+			 */
+			void RenderOccluders(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, const uint8_t* visibility, WorkerPool* pool = nullptr)
+			{
+				if (levels.empty()) throw std::runtime_error("The occlusion culler has not been initialized.");
+				occludedCount = 0;
+				CollectOccluders(shapeList, storage, visibility);
+				Rasterize(storage, pool);
+				BuildHierarchy();
+			}
+
+			/**
+			 * \brief Checks if a world space box is completely hidden behind the occluders of the last Cull.
+			 */
+			bool IsOccluded(const glm::vec3& center, const glm::vec3& extent) const
+			{ // The corners are the transformed center plus or minus the transformed axes
+				const glm::vec4 base = viewProjection * glm::vec4(center, 1);
+				const glm::vec4 axisX = viewProjection[0] * extent.x, axisY = viewProjection[1] * extent.y, axisZ = viewProjection[2] * extent.z;
+				glm::vec2 min(INFINITY), max(-INFINITY);
+				float minDepth = INFINITY;
+				for (int i = 0; i < 8; i++)
+				{
+					const glm::vec4 corner = base + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+					if (corner.z < 0 || corner.w <= 0) return false; // The box is crossing the near plane
+					const glm::vec2 screen = ToScreen(corner);
+					min = glm::min(min, screen);
+					max = glm::max(max, screen);
+					minDepth = std::min(minDepth, corner.z / corner.w);
+				}
+				const float maxX = static_cast<float>(width - 1), maxY = static_cast<float>(height - 1);
+				if (max.x < 0 || max.y < 0 || min.x > maxX + 1 || min.y > maxY + 1) return false;
+				// The pixels touched by the projected box plus a border of one pixel, because the occluders only cover the pixels whose centers they contain
+				const int32_t x0 = static_cast<int32_t>(std::max(0.0f, std::floor(min.x) - 1)), x1 = static_cast<int32_t>(std::min(maxX, std::floor(max.x) + 1));
+				const int32_t y0 = static_cast<int32_t>(std::max(0.0f, std::floor(min.y) - 1)), y1 = static_cast<int32_t>(std::min(maxY, std::floor(max.y) + 1));
+				size_t level = 0;
+				while ((x1 >> level) - (x0 >> level) >= MAX_TEST_TEXELS || (y1 >> level) - (y0 >> level) >= MAX_TEST_TEXELS) level++;
+				const float* depth = levels[level].data();
+				const uint32_t levelWidth = levelWidths[level];
+				for (int32_t y = y0 >> level; y <= y1 >> level; y++)
+				{
+					for (int32_t x = x0 >> level; x <= x1 >> level; x++)
+					{
+						if (depth[y * levelWidth + x] >= minDepth) return false;
+					}
+				}
+				return true;
+			}
+
+			uint32_t GetWidth() const
+			{
+				return width;
+			}
+
+			uint32_t GetHeight() const
+			{
+				return height;
+			}
+
+			/**
+			 * \brief Gets the depth buffer of the last Cull, row by row. Pixels without occluders have a depth of 1.
+			 */
+			const float* GetDepthBuffer() const
+			{
+				return levels[0].data();
+			}
+
+			/**
+			 * \brief Gets the amount of levels of the depth hierarchy, the last level has a size of 1x1.
+			 */
+			size_t GetLevelCount() const
+			{
+				return levels.size();
+			}
+
+			/**
+			 * \brief Gets a level of the depth hierarchy, row by row. Every texel stores the maximum depth of the pixels it covers.
+			 */
+			const float* GetLevel(size_t level) const
+			{
+				return levels[level].data();
+			}
+
+			uint32_t GetLevelWidth(size_t level) const
+			{
+				return levelWidths[level];
+			}
+
+			uint32_t GetLevelHeight(size_t level) const
+			{
+				return levelHeights[level];
+			}
+
+			/**
+			 * \brief Gets the amount of triangles that have been rasterized by the last Cull.
+			 */
+			size_t GetOccluderTriangleCount() const
+			{
+				return triangleCount;
+			}
+
+			/**
+			 * \brief Gets the amount of nodes that have been culled by the last Cull.
+			 */
+			size_t GetOccludedCount() const
+			{
+				return occludedCount;
+			}
+
+		private:
+			void CollectOccluders(const std::vector<Drawable*>& shapeList, const TransformStorage& storage, const uint8_t* visibility)
+			{
+				occluderNodes.clear();
+				occluderMeshes.clear();
+				for (const Drawable* drawable : shapeList)
+				{
+					const Geometry* mesh = drawable->occluder;
+					if (!mesh || !mesh->vertices || !mesh->indices) continue;
+					for (Node* node : drawable->nodes)
+					{
+						if (node->GetTransformStorage() != &storage || (visibility && !visibility[node->GetTransformIndex()])) continue;
+						occluderNodes.push_back(node);
+						occluderMeshes.push_back(mesh);
+					}
+				}
+			}
+
+			template<typename TASK>
+			static void RunOnThreads(WorkerPool* pool, const TASK& task)
+			{
+				if (pool) pool->Run(task);
+				else task(0);
+			}
+
+			void Rasterize(const TransformStorage& storage, WorkerPool* pool)
+			{
+				const uint32_t threadCount = pool ? pool->GetThreadCount() : 1;
+				triangles.resize(threadCount);
+				bins.resize(threadCount);
+				for (uint32_t i = 0; i < threadCount; i++)
+				{
+					triangles[i].clear();
+					bins[i].resize(bandCount);
+					for (std::vector<uint32_t>& bin : bins[i]) bin.clear();
+				}
+				const size_t chunkSize = (occluderNodes.size() + threadCount - 1) / threadCount;
+				RunOnThreads(pool, [&](uint32_t threadId)
+				{ // Every thread sets up the triangles of a part of the occluders and sorts them into the bands
+					const size_t end = std::min(occluderNodes.size(), (threadId + 1) * chunkSize);
+					for (size_t i = threadId * chunkSize; i < end; i++)
+					{
+						SetupOccluder(storage.GetWorldMatrices()[occluderNodes[i]->GetTransformIndex()], occluderMeshes[i], threadId);
+					}
+				});
+				triangleCount = 0;
+				for (const std::vector<Triangle>& threadTriangles : triangles) triangleCount += threadTriangles.size();
+				nextBand = 0;
+				RunOnThreads(pool, [&](uint32_t)
+				{ // The bands don't share any pixels, so they can be rasterized without synchronization
+					uint32_t band;
+					while ((band = nextBand++) < bandCount) RasterizeBand(band);
+				});
+			}
+
+			void SetupOccluder(const glm::mat4x4& worldMat, const Geometry* mesh, uint32_t threadId)
+			{
+				static thread_local std::vector<glm::vec4> clipVertices;
+				const glm::mat4x4 mvp = viewProjection * worldMat;
+				clipVertices.resize(mesh->GetVertexCount());
+				for (uint32_t i = 0; i < mesh->GetVertexCount(); i++)
+				{
+					clipVertices[i] = mvp * glm::vec4(mesh->vertices[i].position, 1);
+				}
+				for (uint32_t i = 0; i + 2 < mesh->GetIndexCount(); i += 3)
+				{
+					const glm::vec4& v0 = clipVertices[mesh->GetIndex(i)];
+					const glm::vec4& v1 = clipVertices[mesh->GetIndex(i + 1)];
+					const glm::vec4& v2 = clipVertices[mesh->GetIndex(i + 2)];
+					if ((v0.x > v0.w && v1.x > v1.w && v2.x > v2.w) || (v0.x < -v0.w && v1.x < -v1.w && v2.x < -v2.w) ||
+						(v0.y > v0.w && v1.y > v1.w && v2.y > v2.w) || (v0.y < -v0.w && v1.y < -v1.w && v2.y < -v2.w) ||
+						(v0.z > v0.w && v1.z > v1.w && v2.z > v2.w) || (v0.z < 0 && v1.z < 0 && v2.z < 0)) continue;
+					if (v0.z >= 0 && v1.z >= 0 && v2.z >= 0)
+					{
+						AddTriangle(ToScreen3(v0), ToScreen3(v1), ToScreen3(v2), threadId);
+						continue;
+					}
+					// Clip the triangle against the near plane, the result is a triangle or a quad
+					const glm::vec4* vertices[3] = { &v0, &v1, &v2 };
+					glm::vec3 polygon[4];
+					int count = 0;
+					for (int j = 0; j < 3; j++)
+					{
+						const glm::vec4& a = *vertices[j];
+						const glm::vec4& b = *vertices[(j + 1) % 3];
+						if (a.z >= 0) polygon[count++] = ToScreen3(a);
+						if ((a.z >= 0) != (b.z >= 0)) polygon[count++] = ToScreen3(a + (b - a) * (a.z / (a.z - b.z)));
+					}
+					AddTriangle(polygon[0], polygon[1], polygon[2], threadId);
+					if (count == 4) AddTriangle(polygon[0], polygon[2], polygon[3], threadId);
+				}
+			}
+
+			glm::vec2 ToScreen(const glm::vec4& clip) const
+			{
+				return glm::vec2((clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height);
+			}
+
+			glm::vec3 ToScreen3(const glm::vec4& clip) const
+			{
+				return glm::vec3(ToScreen(clip), clip.z / clip.w);
+			}
+
+			void AddTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, uint32_t threadId)
+			{
+				const float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+				if (!(std::abs(area) > 1e-6f)) return; // Degenerated or NaN
+				// The pixels whose centers are inside of the bounding box, the floats are clamped before the conversion so they can't overflow
+				const float maxX = static_cast<float>(width - 1), maxY = static_cast<float>(height - 1);
+				const float minPixelX = std::ceil(std::min(std::min(p0.x, p1.x), p2.x) - 0.5f), maxPixelX = std::floor(std::max(std::max(p0.x, p1.x), p2.x) - 0.5f);
+				const float minPixelY = std::ceil(std::min(std::min(p0.y, p1.y), p2.y) - 0.5f), maxPixelY = std::floor(std::max(std::max(p0.y, p1.y), p2.y) - 0.5f);
+				if (maxPixelX < 0 || maxPixelY < 0 || minPixelX > maxX || minPixelY > maxY || minPixelX > maxPixelX || minPixelY > maxPixelY) return;
+				Triangle triangle;
+				triangle.minX = static_cast<int32_t>(std::max(0.0f, minPixelX));
+				triangle.maxX = static_cast<int32_t>(std::min(maxX, maxPixelX));
+				triangle.minY = static_cast<int32_t>(std::max(0.0f, minPixelY));
+				triangle.maxY = static_cast<int32_t>(std::min(maxY, maxPixelY));
+				const float sign = (area > 0) ? 1.0f : -1.0f;
+				const glm::vec3* points[3] = { &p0, &p1, &p2 };
+				for (int i = 0; i < 3; i++)
+				{ // The edge opposite of the point i
+					const glm::vec3& a = *points[(i + 1) % 3];
+					const glm::vec3& b = *points[(i + 2) % 3];
+					triangle.edgeA[i] = (a.y - b.y) * sign;
+					triangle.edgeB[i] = (b.x - a.x) * sign;
+					triangle.edgeC[i] = (a.x * b.y - a.y * b.x) * sign;
+				}
+				triangle.depthA = ((p1.z - p0.z) * (p2.y - p0.y) - (p2.z - p0.z) * (p1.y - p0.y)) / area;
+				triangle.depthB = ((p2.z - p0.z) * (p1.x - p0.x) - (p1.z - p0.z) * (p2.x - p0.x)) / area;
+				triangle.depthC = p0.z - triangle.depthA * p0.x - triangle.depthB * p0.y;
+				const uint32_t index = static_cast<uint32_t>(triangles[threadId].size());
+				triangles[threadId].push_back(triangle);
+				for (uint32_t band = triangle.minY / BAND_HEIGHT; band <= triangle.maxY / BAND_HEIGHT; band++)
+				{
+					bins[threadId][band].push_back(index);
+				}
+			}
+
+			void RasterizeBand(uint32_t band)
+			{
+				float* depth = levels[0].data();
+				const int32_t bandMinY = band * BAND_HEIGHT;
+				const int32_t bandMaxY = std::min(height, (band + 1) * BAND_HEIGHT) - 1;
+				std::fill(depth + bandMinY * width, depth + (bandMaxY + 1) * width, 1.0f);
+				for (size_t thread = 0; thread < triangles.size(); thread++)
+				{
+					for (uint32_t index : bins[thread][band])
+					{
+						const Triangle& triangle = triangles[thread][index];
+						const int32_t minY = std::max(triangle.minY, bandMinY), maxY = std::min(triangle.maxY, bandMaxY);
+						switch (Math::MatrixBatch::GetKernel())
+						{
+#ifdef OPENVULKANO_X86
+							case Math::MatrixBatch::Kernel::AVX2: RasterizeAvx2(triangle, depth, width, minY, maxY); break;
+							case Math::MatrixBatch::Kernel::SSE: RasterizeSse(triangle, depth, width, minY, maxY); break;
+#endif
+							default: RasterizeScalar(triangle, depth, width, minY, maxY); break;
+						}
+					}
+				}
+			}
+
+			static void RasterizeScalar(const Triangle& triangle, float* depth, uint32_t width, int32_t minY, int32_t maxY)
+			{
+				for (int32_t y = minY; y <= maxY; y++)
+				{
+					const float py = y + 0.5f;
+					float* row = depth + y * width;
+					for (int32_t x = triangle.minX; x <= triangle.maxX; x++)
+					{
+						const float px = x + 0.5f;
+						bool inside = true;
+						for (int i = 0; i < 3; i++) inside &= triangle.edgeA[i] * px + triangle.edgeB[i] * py + triangle.edgeC[i] >= 0;
+						if (inside) row[x] = std::min(row[x], triangle.depthA * px + triangle.depthB * py + triangle.depthC);
+					}
+				}
+			}
+
+#ifdef OPENVULKANO_X86
+			/**
+			 * \brief Rasterizes 4 pixels at once. The rows start at a multiple of 4, the extra pixels are outside of the triangle.
+			 */
+			static void RasterizeSse(const Triangle& triangle, float* depth, uint32_t width, int32_t minY, int32_t maxY)
+			{
+				const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), zero = _mm_setzero_ps();
+				const __m128 a0 = _mm_set1_ps(triangle.edgeA[0]), a1 = _mm_set1_ps(triangle.edgeA[1]), a2 = _mm_set1_ps(triangle.edgeA[2]);
+				const __m128 depthA = _mm_set1_ps(triangle.depthA);
+				const int32_t startX = triangle.minX & ~3;
+				for (int32_t y = minY; y <= maxY; y++)
+				{
+					const float py = y + 0.5f;
+					const __m128 row0 = _mm_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+					const __m128 row1 = _mm_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+					const __m128 row2 = _mm_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+					const __m128 rowDepth = _mm_set1_ps(triangle.depthB * py + triangle.depthC);
+					float* row = depth + y * width;
+					for (int32_t x = startX; x <= triangle.maxX; x += 4)
+					{
+						const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+						__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), row0), zero);
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), row1), zero));
+						inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), row2), zero));
+						const __m128 old = _mm_load_ps(row + x);
+						const __m128 nearest = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth));
+						_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+					}
+				}
+			}
+
+			/**
+			 * \brief Rasterizes 8 pixels at once. The rows start at a multiple of 8, the extra pixels are outside of the triangle.
+			 */
+			OPENVULKANO_TARGET_AVX2 static void RasterizeAvx2(const Triangle& triangle, float* depth, uint32_t width, int32_t minY, int32_t maxY)
+			{
+				const __m256 offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f), zero = _mm256_setzero_ps();
+				const __m256 a0 = _mm256_set1_ps(triangle.edgeA[0]), a1 = _mm256_set1_ps(triangle.edgeA[1]), a2 = _mm256_set1_ps(triangle.edgeA[2]);
+				const __m256 depthA = _mm256_set1_ps(triangle.depthA);
+				const int32_t startX = triangle.minX & ~7;
+				for (int32_t y = minY; y <= maxY; y++)
+				{
+					const float py = y + 0.5f;
+					const __m256 row0 = _mm256_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+					const __m256 row1 = _mm256_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+					const __m256 row2 = _mm256_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+					const __m256 rowDepth = _mm256_set1_ps(triangle.depthB * py + triangle.depthC);
+					float* row = depth + y * width;
+					for (int32_t x = startX; x <= triangle.maxX; x += 8)
+					{
+						const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), offsets);
+						__m256 inside = _mm256_cmp_ps(_mm256_fmadd_ps(a0, px, row0), zero, _CMP_GE_OQ);
+						inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(a1, px, row1), zero, _CMP_GE_OQ));
+						inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_fmadd_ps(a2, px, row2), zero, _CMP_GE_OQ));
+						const __m256 old = _mm256_load_ps(row + x);
+						const __m256 nearest = _mm256_min_ps(old, _mm256_fmadd_ps(depthA, px, rowDepth));
+						_mm256_store_ps(row + x, _mm256_blendv_ps(old, nearest, inside));
+					}
+				}
+			}
+#endif
+
+			/**
+			 * \brief Fills the levels above the depth buffer with the maximum depth of the 2x2 texels below them.
+			 */
+			void BuildHierarchy()
+			{
+				for (size_t level = 1; level < levels.size(); level++)
+				{
+					const float* source = levels[level - 1].data();
+					float* target = levels[level].data();
+					const uint32_t sourceWidth = levelWidths[level - 1], sourceHeight = levelHeights[level - 1];
+					for (uint32_t y = 0; y < levelHeights[level]; y++)
+					{
+						const float* row0 = source + 2 * y * sourceWidth;
+						const float* row1 = source + std::min(2 * y + 1, sourceHeight - 1) * sourceWidth;
+						for (uint32_t x = 0; x < levelWidths[level]; x++)
+						{
+							const uint32_t x0 = 2 * x, x1 = std::min(2 * x + 1, sourceWidth - 1);
+							target[y * levelWidths[level] + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+						}
+					}
+				}
+			}
+
+			void TestBounds(const TransformStorage& storage, uint8_t* visibility, WorkerPool* pool)
+			{
+				const Math::BoundsArray& bounds = storage.GetWorldBounds();
+				const auto test = [&](size_t begin, size_t end)
+				{
+					size_t occluded = 0;
+					for (size_t i = begin; i < end; i++)
+					{
+						if (!visibility[i] || !IsOccluded(bounds.GetCenter(i), bounds.GetExtent(i))) continue;
+						visibility[i] = 0;
+						occluded++;
+					}
+					occludedCount += occluded;
+				};
+				if (pool) pool->ParallelFor(storage.Size(), test, MIN_TEST_CHUNK_SIZE);
+				else test(0, storage.Size());
+			}
+		};
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <glm/glm.hpp>
+#include "../Data/MappedFile.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief The visible nodes of one cell of a potentially visible set, a bit for every stable id (Node::GetStableId) of the baked scene.
+		 * Nodes that have been added after the baking are not covered by the bits and always visible, an empty cell does not hide anything.
+		 */
+		struct PvsCell
+		{
+			const uint64_t* bits = nullptr;
+			uint32_t objectCount = 0;
+
+			bool IsEmpty() const
+			{
+				return bits == nullptr;
+			}
+
+			bool IsVisible(uint32_t stableId) const
+			{
+				return !bits || stableId >= objectCount || ((bits[stableId >> 6] >> (stableId & 63)) & 1);
+			}
+		};
+
+		/**
+		 * \brief The header of a baked potentially visible set file. It is followed by the row index of every cell (x fastest, then y, then z),
+		 * padded to 8 bytes, and the rows. Identical rows are only stored once. Every row holds wordsPerRow 64 bit words.
+		 * objectCount is the amount of stable node ids of the baked scene, the scene hash identifies its static nodes (see Scene::CalculatePvsHash).
+		 */
+		struct PvsFileHeader
+		{
+			static constexpr uint32_t MAGIC = 0x53565650; // "PVVS"
+			static constexpr uint32_t VERSION = 2;
+
+			uint32_t magic, version;
+			uint32_t cellCount[3];
+			uint32_t objectCount, wordsPerRow, rowCount;
+			float origin[3];
+			float cellSize;
+			uint32_t staticNodeCount, padding;
+			uint64_t sceneHash;
+
+			size_t GetTotalCellCount() const
+			{
+				return static_cast<size_t>(cellCount[0]) * cellCount[1] * cellCount[2];
+			}
+
+			size_t GetRowsOffset() const
+			{
+				return sizeof(PvsFileHeader) + ((GetTotalCellCount() * sizeof(uint32_t) + 7) & ~static_cast<size_t>(7));
+			}
+		};
+		static_assert(sizeof(PvsFileHeader) % 8 == 0, "The rows after the header must stay 8 byte aligned");
+
+		/**
+		 * \brief A potentially visible set that has been baked with the PvsBaker. The file is memory mapped,
+		 * looking up the visible nodes for a position is O(1) and doesn't copy anything.
+		 */
+		class PotentiallyVisibleSet final
+		{
+			Data::MappedFile file;
+			const PvsFileHeader* header = nullptr;
+			const uint32_t* cellRows = nullptr;
+			const uint64_t* rows = nullptr;
+			glm::vec3 origin;
+			float inverseCellSize = 0;
+
+		public:
+			PotentiallyVisibleSet() = default;
+
+			explicit PotentiallyVisibleSet(const std::string& path)
+			{
+				Open(path);
+			}
+
+			/**
+			 * \brief Maps a baked file, throws if it is not a valid potentially visible set.
+			 */
+			void Open(const std::string& path)
+			{
+				file.Open(path);
+				header = reinterpret_cast<const PvsFileHeader*>(file.GetData());
+				if (file.GetSize() < sizeof(PvsFileHeader) || header->magic != PvsFileHeader::MAGIC || header->version != PvsFileHeader::VERSION ||
+					header->cellSize <= 0 || header->wordsPerRow < (static_cast<uint64_t>(header->objectCount) + 63) / 64 ||
+					file.GetSize() < header->GetRowsOffset() + static_cast<size_t>(header->rowCount) * header->wordsPerRow * sizeof(uint64_t))
+				{
+					Close();
+					throw std::runtime_error("Invalid potentially visible set: " + path);
+				}
+				cellRows = reinterpret_cast<const uint32_t*>(file.GetData() + sizeof(PvsFileHeader));
+				rows = reinterpret_cast<const uint64_t*>(file.GetData() + header->GetRowsOffset());
+				for (size_t i = 0; i < header->GetTotalCellCount(); i++)
+				{
+					if (cellRows[i] >= header->rowCount)
+					{
+						Close();
+						throw std::runtime_error("Invalid potentially visible set: " + path);
+					}
+				}
+				origin = glm::vec3(header->origin[0], header->origin[1], header->origin[2]);
+				inverseCellSize = 1.0f / header->cellSize;
+			}
+
+			void Close()
+			{
+				file.Close();
+				header = nullptr;
+				cellRows = nullptr;
+				rows = nullptr;
+			}
+
+			bool IsOpen() const
+			{
+				return header != nullptr;
+			}
+
+			/**
+			 * \brief Gets the cell that contains a position, positions outside of the baked volume get an empty cell.
+			 */
+			PvsCell GetCell(const glm::vec3& position) const
+			{
+				if (!header) return {};
+				const glm::vec3 cell = glm::floor((position - origin) * inverseCellSize);
+				if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x >= header->cellCount[0] || cell.y >= header->cellCount[1] || cell.z >= header->cellCount[2]) return {};
+				const size_t index = (static_cast<size_t>(cell.z) * header->cellCount[1] + static_cast<size_t>(cell.y)) * header->cellCount[0] + static_cast<size_t>(cell.x);
+				return { rows + static_cast<size_t>(cellRows[index]) * header->wordsPerRow, header->objectCount };
+			}
+
+			const PvsFileHeader* GetHeader() const
+			{
+				return header;
+			}
+		};
+	}
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <glm/glm.hpp>
+#include "Scene.hpp"
+#include "PotentiallyVisibleSet.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		struct PvsBakeSettings
+		{
+			float cellSize = 4; // The edge length of the cubic cells in world units
+			uint32_t samplesPerCell = 16; // The amount of random positions inside of every cell from which rays are cast
+			uint32_t raysPerSample = 512; // The amount of directions that are sampled from every position
+			float maxDistance = INFINITY; // Nodes further away than this from a sample are never visible
+			bool dilate = true; // Adds the nodes visible from the neighbouring cells, to catch small nodes missed by the sampling
+		};
+
+		/**
+		 * \brief Bakes the cell to node visibility of the static nodes (UpdateFrequency::Never) of a scene on the cpu.
+		 * The bounds of the static nodes are divided into a grid of cells. From random positions inside every cell rays are cast into
+		 * evenly distributed directions against the triangles of the static nodes, every node that is hit is visible from the cell.
+		 * Nodes whose bounds overlap a cell are always visible from it and all the other nodes are always visible.
+		 * Nodes are identified by their stable id, so the scene must be built in the same order to use the baked data.
+		 * The file stores a hash of the static nodes, loading it into a different scene fails.
+		 */
+		class PvsBaker final
+		{
+			static constexpr size_t MIN_CHUNK_SIZE = 1;
+
+		public:
+			/**
+			 * \brief Bakes the potentially visible set of a scene and writes it to a file.
+			 * \param scene The scene, its world matrices must be up to date. A spatial index makes the baking a lot faster.
+			 * \param path The file the result is written to
+			 * \param pool Optional worker pool to bake multiple cells in parallel
+			 */
+			static void Bake(const Scene& scene, const std::string& path, const PvsBakeSettings& settings = PvsBakeSettings(), WorkerPool* pool = nullptr)
+			{
+				if (settings.cellSize <= 0) throw std::invalid_argument("The cell size of a potentially visible set must be positive!");
+				const TransformStorage& storage = scene.transforms;
+				const Math::BoundsArray& bounds = storage.GetWorldBounds();
+				const uint32_t objectCount = storage.GetStableIdCount();
+				const uint32_t wordsPerRow = (objectCount + 63) / 64;
+				std::vector<uint8_t> staticNodes(storage.Size(), 0), staticIds(objectCount, 0); // By transform index and by stable id
+				glm::vec3 min(INFINITY), max(-INFINITY);
+				for (uint32_t i = 0; i < storage.Size(); i++)
+				{
+					Node* node = storage.GetNode(i);
+					if (!node || node->drawables.empty() || node->GetUpdateFrequency() != UpdateFrequency::Never) continue;
+					staticNodes[i] = 1;
+					staticIds[node->GetStableId()] = 1;
+					min = glm::min(min, bounds.GetCenter(i) - bounds.GetExtent(i));
+					max = glm::max(max, bounds.GetCenter(i) + bounds.GetExtent(i));
+				}
+				if (min.x > max.x) min = max = glm::vec3(0); // No static nodes, a single cell that sees everything
+
+				PvsFileHeader header = {};
+				header.magic = PvsFileHeader::MAGIC;
+				header.version = PvsFileHeader::VERSION;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					header.cellCount[axis] = std::max(1u, static_cast<uint32_t>(std::ceil((max[axis] - min[axis]) / settings.cellSize)));
+					header.origin[axis] = min[axis];
+				}
+				header.objectCount = objectCount;
+				header.wordsPerRow = wordsPerRow;
+				header.cellSize = settings.cellSize;
+				header.sceneHash = scene.CalculatePvsHash(header.staticNodeCount);
+				const size_t cellCount = header.GetTotalCellCount();
+				std::vector<uint64_t> cells(cellCount * wordsPerRow, 0);
+
+				// The dynamic nodes can't be baked, they are always visible
+				for (uint32_t id = 0; id < objectCount; id++)
+				{
+					if (staticIds[id]) continue;
+					for (size_t cell = 0; cell < cellCount; cell++) SetBit(cells.data() + cell * wordsPerRow, id);
+				}
+				// The sampling could miss a node the camera is standing in
+				for (uint32_t i = 0; i < storage.Size(); i++)
+				{
+					if (!staticNodes[i]) continue;
+					const uint32_t id = storage.GetNode(i)->GetStableId();
+					const glm::uvec3 first = GetCell(header, bounds.GetCenter(i) - bounds.GetExtent(i));
+					const glm::uvec3 last = GetCell(header, bounds.GetCenter(i) + bounds.GetExtent(i));
+					for (uint32_t z = first.z; z <= last.z; z++)
+						for (uint32_t y = first.y; y <= last.y; y++)
+							for (uint32_t x = first.x; x <= last.x; x++)
+								SetBit(cells.data() + GetCellIndex(header, x, y, z) * wordsPerRow, id);
+				}
+
+				RayCaster rayCaster(storage, scene.GetSpatialIndex());
+				rayCaster.SetFilter([&](Node* node) { return staticNodes[node->GetTransformIndex()] != 0; });
+				const glm::vec3 origin = min;
+				const auto bakeCells = [&](size_t begin, size_t end)
+				{
+					std::vector<Math::Ray> rays;
+					std::vector<RaycastHit> hits;
+					for (size_t cell = begin; cell < end; cell++)
+					{
+						const size_t x = cell % header.cellCount[0], y = (cell / header.cellCount[0]) % header.cellCount[1];
+						const size_t z = cell / (static_cast<size_t>(header.cellCount[0]) * header.cellCount[1]);
+						const glm::vec3 cellMin = origin + glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * settings.cellSize;
+						CreateRays(cellMin, settings, static_cast<uint32_t>(cell), rays);
+						hits.resize(rays.size());
+						rayCaster.Cast(rays.data(), rays.size(), hits.data(), settings.maxDistance, RaycastPrecision::Triangles);
+						uint64_t* row = cells.data() + cell * wordsPerRow;
+						for (const RaycastHit& hit : hits)
+						{
+							if (hit.IsHit()) SetBit(row, hit.node->GetStableId());
+						}
+					}
+				};
+				if (pool) pool->ParallelFor(cellCount, bakeCells, MIN_CHUNK_SIZE);
+				else bakeCells(0, cellCount);
+
+				if (settings.dilate) Dilate(header, cells);
+				Write(path, header, cells);
+			}
+
+		private:
+			static void SetBit(uint64_t* row, uint32_t index)
+			{
+				row[index >> 6] |= static_cast<uint64_t>(1) << (index & 63);
+			}
+
+			static glm::uvec3 GetCell(const PvsFileHeader& header, const glm::vec3& position)
+			{
+				glm::uvec3 cell;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const float coordinate = std::floor((position[axis] - header.origin[axis]) / header.cellSize);
+					cell[axis] = static_cast<uint32_t>(std::min(std::max(coordinate, 0.0f), static_cast<float>(header.cellCount[axis] - 1)));
+				}
+				return cell;
+			}
+
+			static size_t GetCellIndex(const PvsFileHeader& header, uint32_t x, uint32_t y, uint32_t z)
+			{
+				return (static_cast<size_t>(z) * header.cellCount[1] + y) * header.cellCount[0] + x;
+			}
+
+			/**
+			 * \brief Creates the rays of a cell. Every sample uses a randomly rotated spherical fibonacci set of directions,
+			 * so the samples together cover the directions more evenly than one fixed set.
+			 */
+			static void CreateRays(const glm::vec3& cellMin, const PvsBakeSettings& settings, uint32_t seed, std::vector<Math::Ray>& rays)
+			{
+				static const float GOLDEN_ANGLE = 2.39996323f;
+				std::minstd_rand random(seed + 1); // The result must not depend on the order the cells are baked in
+				std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+				rays.clear();
+				rays.reserve(static_cast<size_t>(settings.samplesPerCell) * settings.raysPerSample);
+				for (uint32_t sample = 0; sample < settings.samplesPerCell; sample++)
+				{
+					const glm::vec3 position = cellMin + glm::vec3(distribution(random), distribution(random), distribution(random)) * settings.cellSize;
+					const float rotation = distribution(random) * 6.28318531f;
+					for (uint32_t i = 0; i < settings.raysPerSample; i++)
+					{
+						const float y = 1 - (2 * i + 1) / static_cast<float>(settings.raysPerSample);
+						const float radius = std::sqrt(std::max(0.0f, 1 - y * y));
+						const float angle = GOLDEN_ANGLE * i + rotation;
+						rays.emplace_back(position, glm::vec3(std::cos(angle) * radius, y, std::sin(angle) * radius));
+					}
+				}
+			}
+
+			/**
+			 * \brief Adds the visible nodes of the direct neighbours (sharing a face) to every cell.
+			 */
+			static void Dilate(const PvsFileHeader& header, std::vector<uint64_t>& cells)
+			{
+				const std::vector<uint64_t> source = cells;
+				const size_t wordsPerRow = header.wordsPerRow;
+				for (uint32_t z = 0; z < header.cellCount[2]; z++)
+					for (uint32_t y = 0; y < header.cellCount[1]; y++)
+						for (uint32_t x = 0; x < header.cellCount[0]; x++)
+						{
+							uint64_t* row = cells.data() + GetCellIndex(header, x, y, z) * wordsPerRow;
+							const auto add = [&](uint32_t nx, uint32_t ny, uint32_t nz)
+							{
+								const uint64_t* neighbour = source.data() + GetCellIndex(header, nx, ny, nz) * wordsPerRow;
+								for (size_t i = 0; i < wordsPerRow; i++) row[i] |= neighbour[i];
+							};
+							if (x > 0) add(x - 1, y, z);
+							if (x + 1 < header.cellCount[0]) add(x + 1, y, z);
+							if (y > 0) add(x, y - 1, z);
+							if (y + 1 < header.cellCount[1]) add(x, y + 1, z);
+							if (z > 0) add(x, y, z - 1);
+							if (z + 1 < header.cellCount[2]) add(x, y, z + 1);
+						}
+			}
+
+			/**
+			 * \brief Writes the header, the row index of every cell and the unique rows.
+			 */
+			static void Write(const std::string& path, PvsFileHeader header, const std::vector<uint64_t>& cells)
+			{
+				const size_t cellCount = header.GetTotalCellCount();
+				std::map<std::vector<uint64_t>, uint32_t> uniqueRows;
+				std::vector<uint32_t> cellRows(cellCount);
+				std::vector<uint64_t> rows;
+				for (size_t cell = 0; cell < cellCount; cell++)
+				{
+					std::vector<uint64_t> row(cells.begin() + cell * header.wordsPerRow, cells.begin() + (cell + 1) * header.wordsPerRow);
+					const auto inserted = uniqueRows.emplace(row, static_cast<uint32_t>(uniqueRows.size()));
+					if (inserted.second) rows.insert(rows.end(), row.begin(), row.end());
+					cellRows[cell] = inserted.first->second;
+				}
+				header.rowCount = static_cast<uint32_t>(uniqueRows.size());
+
+				std::ofstream file(path, std::ios::binary | std::ios::trunc);
+				if (!file) throw std::runtime_error("Failed to open file for writing: " + path);
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				file.write(reinterpret_cast<const char*>(cellRows.data()), cellRows.size() * sizeof(uint32_t));
+				const uint64_t padding = 0;
+				file.write(reinterpret_cast<const char*>(&padding), header.GetRowsOffset() - sizeof(header) - cellRows.size() * sizeof(uint32_t));
+				file.write(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(uint64_t));
+				if (!file) throw std::runtime_error("Failed to write file: " + path);
+			}
+		};
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "Node.hpp"
+#include "ISpatialIndex.hpp"
+#include "../Math/Ray.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		enum class RaycastPrecision
+		{
+			Bounds, // Hits are reported for the world bounds of the nodes
+			Triangles // Hits are refined against the triangles of the geometries of the drawables
+		};
+
+		struct RaycastHit
+		{
+			Node* node = nullptr;
+			Drawable* drawable = nullptr; // Only set for RaycastPrecision::Triangles
+			float distance = INFINITY;
+			uint32_t triangle = UINT32_MAX; // The index of the first index of the hit triangle, only set for RaycastPrecision::Triangles
+
+			bool IsHit() const
+			{
+				return node != nullptr;
+			}
+		};
+
+		/**
+		 * \brief Finds the closest hits of batches of rays with the nodes of a transform storage.
+		 * The candidates of a ray are taken from the spatial index if there is one, otherwise all the world bounds of the storage are tested with simd.
+		 */
+		class RayCaster final
+		{
+			static constexpr uint32_t MIN_CHUNK_SIZE = 64;
+
+			const TransformStorage& storage;
+			const ISpatialIndex* spatialIndex;
+			std::function<bool(Node*)> filter;
+
+		public:
+			/**
+			 * \param storage The storage holding the nodes, it must be up to date
+			 * \param spatialIndex Optional spatial index of the storage, strongly recommended for large scenes
+			 */
+			RayCaster(const TransformStorage& storage, const ISpatialIndex* spatialIndex) : storage(storage), spatialIndex(spatialIndex)
+			{}
+
+			/**
+			 * \brief Sets a filter for the nodes that can be hit, nodes for which it returns false are ignored. An empty filter accepts all nodes.
+			 */
+			void SetFilter(const std::function<bool(Node*)>& filter)
+			{
+				this->filter = filter;
+			}
+
+			/**
+			 * \brief Finds the closest hit of every ray.
+			 * \param rays The rays to cast
+			 * \param count The amount of rays
+			 * \param hits Receives the closest hit of every ray, must be able to hold count hits
+			 * \param maxDistance Hits further away will be ignored
+			 * \param precision Whether the hits should be refined against the triangles of the geometries
+			 * \param pool Optional worker pool to split the rays between multiple threads
+			 */
+			void Cast(const Math::Ray* rays, size_t count, RaycastHit* hits, float maxDistance, RaycastPrecision precision, WorkerPool* pool = nullptr) const
+			{
+				const auto castRange = [&](size_t begin, size_t end)
+				{
+					std::vector<RayHit> candidates;
+					std::vector<float> distances;
+					for (size_t i = begin; i < end; i++)
+					{
+						hits[i] = Cast(rays[i], maxDistance, precision, candidates, distances);
+					}
+				};
+				if (pool) pool->ParallelFor(count, castRange, MIN_CHUNK_SIZE);
+				else castRange(0, count);
+			}
+
+		private:
+			RaycastHit Cast(const Math::Ray& ray, float maxDistance, RaycastPrecision precision, std::vector<RayHit>& candidates, std::vector<float>& distances) const
+			{
+				RaycastHit hit;
+				hit.distance = maxDistance;
+				const auto visit = [&](Node* node, float distance)
+				{
+					if (filter && !filter(node)) return hit.distance;
+					if (precision == RaycastPrecision::Triangles) IntersectTriangles(ray, node, hit);
+					else if (distance < hit.distance || !hit.IsHit())
+					{
+						hit.node = node;
+						hit.distance = distance;
+					}
+					return hit.distance;
+				};
+				if (spatialIndex) spatialIndex->TraverseRay(ray, maxDistance, visit);
+				else
+				{ // Sort the candidates, so the search can stop at the first one that is further away than the closest hit
+					candidates.clear();
+					distances.resize(storage.Size());
+					ray.IntersectBoxes(storage.GetWorldBounds(), 0, storage.Size(), maxDistance, distances.data());
+					for (uint32_t i = 0; i < distances.size(); i++)
+					{
+						Node* node = storage.GetNode(i);
+						if (distances[i] != INFINITY && node && !node->drawables.empty()) candidates.push_back({ node, distances[i] });
+					}
+					std::sort(candidates.begin(), candidates.end(), [](const RayHit& a, const RayHit& b) { return a.distance < b.distance; });
+					for (const RayHit& candidate : candidates)
+					{
+						if (candidate.distance > hit.distance) break;
+						visit(candidate.node, candidate.distance);
+					}
+				}
+				if (!hit.IsHit()) hit.distance = INFINITY;
+				return hit;
+			}
+
+			/**
+			 * \brief Intersects the ray with the triangles of all the drawables of a node in the local space of the node.
+			 */
+			void IntersectTriangles(const Math::Ray& ray, Node* node, RaycastHit& hit) const
+			{
+				const Math::Ray localRay = ray.Transform(glm::inverse(storage.GetWorldMatrices()[node->GetTransformIndex()]));
+				for (Drawable* drawable : node->drawables)
+				{
+					const Geometry* mesh = drawable->mesh;
+					if (!mesh || !mesh->vertices || !mesh->indices) continue;
+					const Vertex* vertices = mesh->GetVertices();
+					for (uint32_t i = 0; i + 2 < mesh->GetIndexCount(); i += 3)
+					{
+						float distance;
+						if (!localRay.IntersectTriangle(vertices[mesh->GetIndex(i)].position, vertices[mesh->GetIndex(i + 1)].position,
+														vertices[mesh->GetIndex(i + 2)].position, hit.distance, distance)) continue;
+						hit.node = node;
+						hit.drawable = drawable;
+						hit.distance = distance;
+						hit.triangle = i;
+					}
+				}
+			}
+		};
+	}
+}
@@ -1,6 +1,14 @@
 #pragma once
+#include <memory>
+#include <algorithm>
 #include "Node.hpp"
 #include "Camera.hpp"
+#include "DrawList.hpp"
+#include "Bvh.hpp"
+#include "SpatialHashGrid.hpp"
+#include "RayCaster.hpp"
+#include "SceneJournal.hpp"
+#include "../Data/ObjectPool.hpp"
 
 namespace openVulkanoCpp
 {
@@ -10,8 +18,19 @@ namespace openVulkanoCpp
 		{
 			Node* root;
 			std::vector<Drawable*> shapeList;
-			Shader* shader;
-			Camera* camera;
+			TransformStorage transforms;
+			Shader* shader = nullptr;
+			Camera* camera = nullptr;
+			Data::ObjectPool<Node> nodePool;
+			Data::ObjectPool<Drawable> drawablePool;
+			Data::ObjectPool<Geometry> geometryPool;
+			SceneJournal journal;
+			std::unique_ptr<ISpatialIndex> spatialIndex;
+			std::unique_ptr<OcclusionCuller> occlusionCuller;
+			std::unique_ptr<PotentiallyVisibleSet> potentiallyVisibleSet;
+			float lodHysteresis = LodSelector::DEFAULT_HYSTERESIS;
+			float minContributionSize = 0;
+			float viewportHeight = 0;
 
 		public:
 			Scene() : root(nullptr) {}
@@ -23,9 +42,7 @@ namespace openVulkanoCpp
 
 			void Init() override
 			{
-				Node* newRoot = new Node();
-				newRoot->Init();
-				Init(newRoot);
+				Init(CreateNode());
 			}
 
 			void Init(Node* root)
@@ -33,12 +50,107 @@ namespace openVulkanoCpp
 				if (root->GetParent()) throw std::runtime_error("Node has a parent! Only nodes without a parent may be a root node!");
 				root->SetScene(this);
 				root->SetParent(root);
+				root->MoveTransform(&transforms, TransformStorage::INVALID_INDEX);
 				this->root = root;
 			}
 
+			/**
+			 * \brief Closes the scene and releases all the nodes, drawables and geometries that have been created by the scene.
+			 * Nodes that have not been created by the scene will be unlinked and must be initialized again before they can be reused.
+			 * The spatial index is emptied, the occlusion culling and the potentially visible set are disabled.
+			 */
 			void Close() override
 			{
-				//TODO
+				// The spatial index, the occluders and the visibility set reference nodes that are about to be released
+				transforms.SetSpatialIndex(nullptr);
+				if (spatialIndex) spatialIndex->Clear();
+				occlusionCuller.reset();
+				potentiallyVisibleSet.reset();
+				// Unlink everything first, so the objects in the pools can be released in any order
+				for (size_t i = 0; i < transforms.Size(); i++)
+				{
+					Node* node = transforms.GetNode(i);
+					if (!node) continue;
+					node->children.clear();
+					node->drawables.clear();
+					node->drawableSlots.clear();
+					node->parent = nullptr;
+					node->scene = nullptr;
+					node->stableIdOwner = nullptr;
+					node->ReleaseTransform();
+				}
+				for (Drawable* drawable : shapeList)
+				{
+					drawable->nodes.clear();
+					drawable->nodeSlots.clear();
+					drawable->nodeLods.clear();
+					drawable->sceneIndex = Drawable::INVALID_SLOT;
+					drawable->scene = nullptr;
+				}
+				shapeList.clear();
+				nodePool.Clear();
+				drawablePool.Clear();
+				geometryPool.Clear();
+				journal.Clear();
+				root = nullptr;
+				transforms.ResetStableIds();
+				transforms.SetSpatialIndex(spatialIndex.get()); // Keeps the selected index for the next Init
+			}
+
+			/**
+			 * \brief Creates a new initialized node. The node is stored in the node pool of the scene and will be released when the scene gets closed.
+			 */
+			Node* CreateNode()
+			{
+				Node* node = nodePool.Create();
+				node->Init();
+				return node;
+			}
+
+			/**
+			 * \brief Creates a new drawable. The drawable is stored in the drawable pool of the scene and will be released when the scene gets closed.
+			 */
+			Drawable* CreateDrawable()
+			{
+				return drawablePool.Create();
+			}
+
+			Drawable* CreateDrawable(const Drawable* toCopy)
+			{
+				return drawablePool.Create(toCopy);
+			}
+
+			/**
+			 * \brief Creates a new geometry. The geometry is stored in the geometry pool of the scene and will be released when the scene gets closed.
+			 */
+			Geometry* CreateGeometry()
+			{
+				return geometryPool.Create();
+			}
+
+			/**
+			 * \brief Releases a node that has been created with CreateNode.
+			 */
+			void DestroyNode(Node* node)
+			{
+				node->Close();
+				nodePool.Destroy(node);
+			}
+
+			/**
+			 * \brief Releases a drawable that has been created with CreateDrawable. The drawable must not be used by any node.
+			 */
+			void DestroyDrawable(Drawable* drawable)
+			{
+				drawablePool.Destroy(drawable);
+			}
+
+			/**
+			 * \brief Releases a geometry that has been created with CreateGeometry.
+			 */
+			void DestroyGeometry(Geometry* geometry)
+			{
+				geometryPool.Destroy(geometry);
 			}
 
 			Node* GetRoot() const
@@ -49,16 +161,333 @@ namespace openVulkanoCpp
 			void RegisterDrawable(Drawable* drawable)
 			{
 				if (drawable->GetScene() != this) drawable->SetScene(this);
-				if (Utils::Contains(shapeList, drawable)) return; // Prevent duplicate entries
+				if (drawable->sceneIndex != Drawable::INVALID_SLOT) return; // Prevent duplicate entries
+				drawable->sceneIndex = static_cast<uint32_t>(shapeList.size());
 				shapeList.push_back(drawable);
+				journal.DrawableAdded(drawable);
 			}
 
 			void RemoveDrawable(Drawable* drawable)
 			{
-				Utils::Remove(shapeList, drawable);
+				const uint32_t index = drawable->sceneIndex;
+				if (index != Drawable::INVALID_SLOT && index < shapeList.size() && shapeList[index] == drawable)
+				{
+					shapeList[index] = shapeList.back();
+					shapeList[index]->sceneIndex = index;
+					shapeList.pop_back();
+					journal.DrawableRemoved(drawable);
+				}
+				drawable->sceneIndex = Drawable::INVALID_SLOT;
 				drawable->SetScene(nullptr);
 			}
 
+			/**
+			 * \brief Recalculates the world matrices of all nodes that have been changed since the last update.
+			 * This should be called once per frame, before the world matrices get used for rendering.
+			 * \param workerPool Optional worker pool, if set the world matrices will be updated in parallel level by level.
+			 */
+			void UpdateWorldMatrices(WorkerPool* workerPool = nullptr)
+			{
+				transforms.Update(workerPool);
+				TransformStorage::GetDetachedStorage()->Update();
+				if (camera) camera->UpdateViewMatrix();
+			}
+
+			/**
+			 * \brief Selects the spatial index of the scene. The index will be filled with all the nodes of the scene that have drawables
+			 * and will be kept up to date by UpdateWorldMatrices. Without a spatial index, culling checks every node of the scene.
+			 * The bvh works best for mostly static scenes, the hash grid for scenes where most of the nodes move every frame.
+			 */
+			void SetSpatialIndex(SpatialIndexType type)
+			{
+				switch (type)
+				{
+					case SpatialIndexType::Bvh: SetSpatialIndex(std::unique_ptr<ISpatialIndex>(new Bvh())); break;
+					case SpatialIndexType::HashGrid: SetSpatialIndex(std::unique_ptr<ISpatialIndex>(new SpatialHashGrid())); break;
+					default: SetSpatialIndex(std::unique_ptr<ISpatialIndex>()); break;
+				}
+			}
+
+			/**
+			 * \brief Sets a spatial index that has been configured by the caller, the scene takes ownership of it.
+			 */
+			void SetSpatialIndex(std::unique_ptr<ISpatialIndex> index)
+			{
+				transforms.SetSpatialIndex(nullptr);
+				spatialIndex = std::move(index);
+				if (!spatialIndex) return;
+				spatialIndex->Clear();
+				transforms.Update();
+				std::vector<Node*> nodes;
+				nodes.reserve(transforms.Size());
+				for (size_t i = 0; i < transforms.Size(); i++)
+				{
+					if (transforms.GetNode(i)) nodes.push_back(transforms.GetNode(i));
+				}
+				spatialIndex->Update(nodes.data(), nodes.size());
+				transforms.SetSpatialIndex(spatialIndex.get());
+			}
+
+			/**
+			 * \brief Gets the spatial index of the scene, nullptr if none has been selected. It is only up to date after UpdateWorldMatrices.
+			 */
+			const ISpatialIndex* GetSpatialIndex() const
+			{
+				return spatialIndex.get();
+			}
+
+			/**
+			 * \brief Fills a draw list with the node/drawable pairs that are inside of a frustum.
+			 * The world matrices must have been updated with UpdateWorldMatrices first.
+			 */
+			void Cull(const Math::Frustum& frustum, DrawList& drawList, WorkerPool* workerPool = nullptr)
+			{
+				if (spatialIndex) drawList.Build(shapeList, transforms, *spatialIndex, frustum, workerPool);
+				else drawList.Build(shapeList, transforms, frustum, workerPool);
+			}
+
+			/**
+			 * \brief Fills a draw list with the node/drawable pairs that are inside of the frustum of a view projection matrix
+			 * and, if occlusion culling is enabled, not hidden behind the occluders of the drawables.
+			 * If the scene has a camera, the levels of detail of the drawables are selected for it.
+			 * The world matrices must have been updated with UpdateWorldMatrices first.
+			 */
+			void Cull(const glm::mat4x4& viewProjection, DrawList& drawList, WorkerPool* workerPool = nullptr)
+			{
+				const Math::Frustum frustum = CreateFrustum(viewProjection);
+				if (!camera)
+				{
+					Cull(viewProjection, frustum, drawList, workerPool, nullptr);
+					return;
+				}
+				const LodSelector lodSelector(*camera, lodHysteresis);
+				Cull(viewProjection, frustum, drawList, workerPool, &lodSelector, GetPvsCell());
+			}
+
+			void Cull(const glm::mat4x4& viewProjection, DrawList& drawList, WorkerPool* workerPool, const LodSelector* lodSelector)
+			{
+				Cull(viewProjection, CreateFrustum(viewProjection), drawList, workerPool, lodSelector);
+			}
+
+			void Cull(const glm::mat4x4& viewProjection, const Math::Frustum& frustum, DrawList& drawList, WorkerPool* workerPool, const LodSelector* lodSelector,
+					  const PvsCell& pvsCell = PvsCell())
+			{
+				if (occlusionCuller) occlusionCuller->SetViewProjection(viewProjection);
+				if (spatialIndex) drawList.Build(shapeList, transforms, *spatialIndex, frustum, workerPool, occlusionCuller.get(), lodSelector, pvsCell);
+				else drawList.Build(shapeList, transforms, frustum, workerPool, occlusionCuller.get(), lodSelector, pvsCell);
+			}
+
+			/**
+			 * \brief Sets the fraction of a lod threshold the projected size of a node has to move past it before its level changes.
+			 */
+			void SetLodHysteresis(float hysteresis)
+			{
+				lodHysteresis = hysteresis;
+			}
+
+			float GetLodHysteresis() const
+			{
+				return lodHysteresis;
+			}
+
+			/**
+			 * \brief Creates the frustum of a view projection matrix. If the scene has a camera and contribution culling is enabled,
+			 * the frustum also culls the nodes that are too small on screen.
+			 */
+			Math::Frustum CreateFrustum(const glm::mat4x4& viewProjection) const
+			{
+				Math::Frustum frustum(viewProjection);
+				if (camera) frustum.SetContributionCulling(camera->projection, glm::vec3(glm::inverse(camera->view)[3]), viewportHeight, minContributionSize);
+				return frustum;
+			}
+
+			/**
+			 * \brief Enables the contribution culling. Nodes whose projected bounding sphere is smaller than the given amount of pixels are not drawn.
+			 * It needs a camera and the viewport height, which is set by the renderer.
+			 * \param minPixelSize The minimum diameter of a node on screen in pixels, 0 disables the contribution culling
+			 */
+			void SetContributionCulling(float minPixelSize)
+			{
+				minContributionSize = minPixelSize;
+			}
+
+			float GetContributionCullingSize() const
+			{
+				return minContributionSize;
+			}
+
+			/**
+			 * \brief Sets the height of the viewport the scene is rendered to in pixels.
+			 */
+			void SetViewportHeight(float height)
+			{
+				viewportHeight = height;
+			}
+
+			float GetViewportHeight() const
+			{
+				return viewportHeight;
+			}
+
+			/**
+			 * \brief Enables the software occlusion culling. Only drawables with an occluder geometry can hide other nodes.
+			 * The occluders are rasterized into a depth buffer of the given size, a small buffer (e.g. 256x128) is usually sufficient.
+			 * \param width The width of the depth buffer, 0 disables the occlusion culling
+			 * \param height The height of the depth buffer
+			 */
+			void SetOcclusionCulling(uint32_t width, uint32_t height)
+			{
+				if (width && height) occlusionCuller.reset(new OcclusionCuller(width, height));
+				else occlusionCuller.reset();
+			}
+
+			/**
+			 * \brief Loads a potentially visible set that has been baked for this scene with the PvsBaker. The file stays memory mapped,
+			 * every Cull with a camera and the gpu culling of the renderer remove the nodes that are not visible from the cell of the camera.
+			 * Throws if the file has been baked for a different scene, see CalculatePvsHash.
+			 * \param file The baked file, an empty path disables the potentially visible set
+			 */
+			void SetPotentiallyVisibleSet(const std::string& file)
+			{
+				if (file.empty())
+				{
+					potentiallyVisibleSet.reset();
+					return;
+				}
+				std::unique_ptr<PotentiallyVisibleSet> pvs(new PotentiallyVisibleSet(file));
+				uint32_t staticNodeCount;
+				const uint64_t hash = CalculatePvsHash(staticNodeCount);
+				if (pvs->GetHeader()->sceneHash != hash || pvs->GetHeader()->staticNodeCount != staticNodeCount)
+				{
+					throw std::runtime_error("The potentially visible set has been baked for a different scene: " + file);
+				}
+				potentiallyVisibleSet = std::move(pvs);
+			}
+
+			/**
+			 * \brief Calculates the hash that identifies the static nodes (UpdateFrequency::Never with drawables) of the scene for a potentially visible set.
+			 * It covers the stable ids of the nodes and the sizes of the meshes of their drawables, not their positions.
+			 * \param staticNodeCount Receives the amount of static nodes
+			 */
+			uint64_t CalculatePvsHash(uint32_t& staticNodeCount) const
+			{
+				std::vector<Node*> staticNodes;
+				for (uint32_t i = 0; i < transforms.Size(); i++)
+				{
+					Node* node = transforms.GetNode(i);
+					if (node && !node->drawables.empty() && node->GetUpdateFrequency() == UpdateFrequency::Never) staticNodes.push_back(node);
+				}
+				std::sort(staticNodes.begin(), staticNodes.end(), [](const Node* a, const Node* b) { return a->GetStableId() < b->GetStableId(); });
+				uint64_t hash = 14695981039346656037ull; // FNV-1a
+				const auto add = [&hash](uint32_t value)
+				{
+					for (int i = 0; i < 4; i++) hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+				};
+				for (const Node* node : staticNodes)
+				{
+					add(node->GetStableId());
+					add(static_cast<uint32_t>(node->drawables.size()));
+					for (const Drawable* drawable : node->drawables)
+					{
+						add(drawable->mesh ? drawable->mesh->GetVertexCount() : 0);
+						add(drawable->mesh ? drawable->mesh->GetIndexCount() : 0);
+					}
+				}
+				staticNodeCount = static_cast<uint32_t>(staticNodes.size());
+				return hash;
+			}
+
+			const PotentiallyVisibleSet* GetPotentiallyVisibleSet() const
+			{
+				return potentiallyVisibleSet.get();
+			}
+
+			/**
+			 * \brief Gets the cell of the potentially visible set that contains the camera, an empty cell if there is no camera or no potentially visible set.
+			 */
+			PvsCell GetPvsCell() const
+			{
+				if (!camera || !potentiallyVisibleSet) return PvsCell();
+				return potentiallyVisibleSet->GetCell(glm::vec3(glm::inverse(camera->view)[3]));
+			}
+
+			/**
+			 * \brief Rasterizes the occluders of all nodes for a view projection matrix without culling anything,
+			 * so the depth hierarchy can be used by a culling pass that runs somewhere else.
+			 * The world matrices must have been updated with UpdateWorldMatrices first.
+			 * \return The occlusion culler holding the depth hierarchy, nullptr if occlusion culling is disabled
+			 */
+			const OcclusionCuller* RenderOccluders(const glm::mat4x4& viewProjection, WorkerPool* workerPool = nullptr)
+			{
+				if (!occlusionCuller) return nullptr;
+				occlusionCuller->SetViewProjection(viewProjection);
+				occlusionCuller->RenderOccluders(shapeList, transforms, nullptr, workerPool);
+				return occlusionCuller.get();
+			}
+
+			/**
+			 * \brief Gets the occlusion culler of the scene, nullptr if occlusion culling is disabled.
+			 */
+			const OcclusionCuller* GetOcclusionCuller() const
+			{
+				return occlusionCuller.get();
+			}
+
+			/**
+			 * \brief Finds the closest hit of every ray with the nodes of the scene that have drawables.
+			 * The world matrices must have been updated with UpdateWorldMatrices first. Large scenes should use a spatial index.
+			 * \param rays The rays to cast
+			 * \param count The amount of rays
+			 * \param hits Receives the closest hit of every ray, must be able to hold count hits
+			 * \param maxDistance Hits further away will be ignored
+			 * \param precision Whether the hits should be refined against the triangles of the geometries
+			 * \param workerPool Optional worker pool to split the rays between multiple threads
+			 */
+			void Raycast(const Math::Ray* rays, size_t count, RaycastHit* hits, float maxDistance = INFINITY,
+						 RaycastPrecision precision = RaycastPrecision::Triangles, WorkerPool* workerPool = nullptr) const
+			{
+				RayCaster(transforms, spatialIndex.get()).Cast(rays, count, hits, maxDistance, precision, workerPool);
+			}
+
+			RaycastHit Raycast(const Math::Ray& ray, float maxDistance = INFINITY, RaycastPrecision precision = RaycastPrecision::Triangles) const
+			{
+				RaycastHit hit;
+				Raycast(&ray, 1, &hit, maxDistance, precision);
+				return hit;
+			}
+
+			/**
+			 * \brief Sets the local matrices of many nodes of the scene in one pass. The world matrices will be updated by the next UpdateWorldMatrices.
+			 * Calls with disjoint sets of nodes may be done from multiple threads at the same time,
+			 * as long as the scene is not modified otherwise while they are running.
+			 * \throws std::runtime_error If one of the nodes is not part of the scene
+			 */
+			void SetMatrices(Node* const* nodes, const glm::mat4x4* mats, size_t count)
+			{
+				transforms.SetLocalMatrices(nodes, mats, count);
+			}
+
+			/**
+			 * \brief Sets the positions of many nodes of the scene in one pass. Works like SetMatrices.
+			 */
+			void SetPositions(Node* const* nodes, const glm::vec3* positions, size_t count)
+			{
+				transforms.SetPositions(nodes, positions, count);
+			}
+
+			/**
+			 * \brief Gets the journal of the scene. It is disabled by default and needs to be enabled and cleared by its consumer.
+			 */
+			SceneJournal& GetJournal()
+			{
+				return journal;
+			}
+
+			TransformStorage* GetTransformStorage()
+			{
+				return &transforms;
+			}
+
 			void SetCamera(Camera* camera)
 			{
 				this->camera = camera;
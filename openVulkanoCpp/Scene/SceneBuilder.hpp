@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <stdexcept>
+#include <glm/glm.hpp>
+#include "Scene.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Describes a node that should be created by the SceneBuilder.
+		 */
+		struct NodeDescription
+		{
+			static constexpr uint32_t ROOT = UINT32_MAX;
+
+			uint32_t parent = ROOT; // The index of the description of the parent, parents must be described before their children
+			glm::mat4x4 matrix = glm::mat4x4(1);
+			UpdateFrequency updateFrequency = UpdateFrequency::Never;
+			Drawable* drawable = nullptr;
+		};
+
+		/**
+		 * \brief Creates many nodes of a scene at once. The nodes are linked in one linear pass and their world matrices are resolved once at the end,
+		 * instead of growing the containers and walking the hierarchy for every single node.
+		 */
+		class SceneBuilder
+		{
+			Scene* scene;
+
+		public:
+			explicit SceneBuilder(Scene* scene) : scene(scene)
+			{}
+
+			/**
+			 * \brief Reserves the memory for objects that will be added to the scene.
+			 * \param nodeCount The amount of nodes that will be added
+			 * \param drawableCount The amount of drawables that will be added
+			 * \param geometryCount The amount of geometries that will be added
+			 */
+			void Reserve(size_t nodeCount, size_t drawableCount = 0, size_t geometryCount = 0)
+			{
+				scene->nodePool.Reserve(scene->nodePool.GetSize() + nodeCount);
+				scene->drawablePool.Reserve(scene->drawablePool.GetSize() + drawableCount);
+				scene->geometryPool.Reserve(scene->geometryPool.GetSize() + geometryCount);
+				scene->transforms.Reserve(scene->transforms.Size() + nodeCount);
+				scene->shapeList.reserve(scene->shapeList.size() + drawableCount);
+			}
+
+			/**
+			 * \brief Creates the described nodes inside the scene. All the descriptions are validated before anything is created.
+			 * \param descriptions The descriptions of the nodes
+			 * \param count The amount of descriptions
+			 * \return The created nodes, in the same order as their descriptions
+			 * \throws std::runtime_error If the scene is not initialized or a description references a parent that is not described before it
+			 */
+			std::vector<Node*> Build(const NodeDescription* descriptions, size_t count)
+			{
+				Node* root = scene->GetRoot();
+				if (!root) throw std::runtime_error("The scene must be initialized before nodes can be added!");
+				std::vector<uint32_t> childCounts(count, 0);
+				uint32_t rootChildCount = 0;
+				for (size_t i = 0; i < count; i++)
+				{
+					const uint32_t parent = descriptions[i].parent;
+					if (parent == NodeDescription::ROOT) rootChildCount++;
+					else if (parent < i) childCounts[parent]++;
+					else throw std::runtime_error("The parent of a node must be described before the node!");
+				}
+
+				Reserve(count);
+				root->children.reserve(root->children.size() + rootChildCount);
+				std::vector<Node*> nodes(count);
+				for (size_t i = 0; i < count; i++)
+				{
+					const NodeDescription& description = descriptions[i];
+					Node* parent = (description.parent == NodeDescription::ROOT) ? root : nodes[description.parent];
+					Node* node = scene->nodePool.Create();
+					node->parent = parent;
+					node->scene = scene;
+					node->matrixUpdateFrequency = description.updateFrequency;
+					node->children.reserve(childCounts[i]);
+					node->childIndex = static_cast<uint32_t>(parent->children.size());
+					parent->children.push_back(node);
+					node->transforms = &scene->transforms;
+					node->transformIndex = scene->transforms.Add(node, parent->transformIndex, description.matrix);
+					node->stableId = scene->transforms.AllocateStableId();
+					node->stableIdOwner = &scene->transforms;
+					if (description.drawable) node->AddDrawable(description.drawable);
+					nodes[i] = node;
+				}
+				scene->transforms.Update();
+				return nodes;
+			}
+		};
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		struct Drawable;
+
+		/**
+		 * \brief Records the drawables that have been added to a scene since it has been cleared the last time, so a consumer (like the renderer) can upload them incrementally.
+		 * The journal only tracks added drawables. Drawables that have been added and removed again before the journal got cleared will not be reported.
+		 * Removed drawables, added or removed nodes and moved nodes are not recorded, the renderer reads the world matrices of the visible nodes every frame.
+		 * The added drawables are not kept in the order they have been added. The journal only records changes while it is enabled.
+		 */
+		class SceneJournal final
+		{
+			std::vector<Drawable*> addedDrawables;
+			// The index of every drawable inside of the added list, so removing a freshly added drawable doesn't have to search for it
+			std::unordered_map<const Drawable*, size_t> addedDrawableSlots;
+			bool enabled = false;
+
+		public:
+			void SetEnabled(bool enabled)
+			{
+				this->enabled = enabled;
+				if (!enabled) Clear();
+			}
+
+			bool IsEnabled() const
+			{
+				return enabled;
+			}
+
+			void DrawableAdded(Drawable* drawable)
+			{
+				if (enabled && addedDrawableSlots.emplace(drawable, addedDrawables.size()).second) addedDrawables.push_back(drawable);
+			}
+
+			/**
+			 * \brief Drops a drawable from the added list, so a drawable that is destroyed before the journal got cleared is never reported.
+			 */
+			void DrawableRemoved(const Drawable* drawable)
+			{
+				const auto it = addedDrawableSlots.find(drawable);
+				if (it == addedDrawableSlots.end()) return;
+				// Swap remove, the last added drawable takes over the slot
+				const size_t slot = it->second;
+				addedDrawableSlots.erase(it);
+				addedDrawables[slot] = addedDrawables.back();
+				addedDrawables.pop_back();
+				if (slot < addedDrawables.size()) addedDrawableSlots[addedDrawables[slot]] = slot;
+			}
+
+			const std::vector<Drawable*>& GetAddedDrawables() const
+			{
+				return addedDrawables;
+			}
+
+			bool IsEmpty() const
+			{
+				return addedDrawables.empty();
+			}
+
+			/**
+			 * \brief Clears all the recorded changes. The capacity of the list will be kept, so the journal doesn't allocate every frame.
+			 */
+			void Clear()
+			{
+				addedDrawables.clear();
+				addedDrawableSlots.clear();
+			}
+		};
+	}
+}
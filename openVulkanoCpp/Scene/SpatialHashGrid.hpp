@@ -0,0 +1,361 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "ISpatialIndex.hpp"
+#include "Node.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		/**
+		 * \brief Loose uniform grid over the world bounds of the nodes of a scene, only the occupied cells are stored in a hash map.
+		 * Every node is stored in the cell that contains the center of its bounds, so a changed node is moved with O(1) work.
+		 * The cells are loose: they enclose all the nodes that are not bigger than a cell, nodes that are bigger are stored in a separate list.
+		 * Unlike a hierarchy, the grid does not degrade if most of the nodes are moved every frame.
+		 */
+		class SpatialHashGrid final : public ISpatialIndex
+		{
+			static constexpr uint64_t LARGE_CELL = UINT64_MAX; // Nodes that are too big for the grid or too far away from the origin
+			static constexpr uint64_t REMOVE_CELL = UINT64_MAX - 1; // Only used for pending changes
+			static constexpr uint64_t UNCHANGED_CELL = UINT64_MAX - 2; // Only used for pending changes
+			static constexpr int32_t COORDINATE_BITS = 21;
+			static constexpr int32_t COORDINATE_LIMIT = 1 << (COORDINATE_BITS - 1);
+			static constexpr uint64_t COORDINATE_MASK = (1ull << COORDINATE_BITS) - 1;
+			static constexpr uint32_t MIN_PARALLEL_CHUNK_SIZE = 1024;
+
+			struct Entry
+			{
+				glm::vec3 min, max;
+				Node* node;
+				uint64_t cell;
+				uint32_t cellSlot; // The index of the entry inside its cell
+			};
+
+			struct Change
+			{
+				glm::vec3 min, max;
+				uint64_t cell;
+			};
+
+			struct CellHash
+			{
+				size_t operator()(uint64_t key) const
+				{
+					key ^= key >> 33;
+					key *= 0xFF51AFD7ED558CCDull;
+					key ^= key >> 33;
+					return static_cast<size_t>(key);
+				}
+			};
+
+			float cellSize, inverseCellSize;
+			std::vector<Entry> entries;
+			std::unordered_map<uint64_t, std::vector<uint32_t>, CellHash> cells;
+			std::vector<Change> changes;
+			glm::vec3 occupiedMin = glm::vec3(INFINITY), occupiedMax = glm::vec3(-INFINITY); // Loose bounds of all the cells that have ever been occupied
+
+		public:
+			/**
+			 * \param cellSize The edge length of the cells, it should be about the size of the typical node of the scene
+			 */
+			explicit SpatialHashGrid(float cellSize = 2.0f) : cellSize(cellSize), inverseCellSize(1.0f / cellSize)
+			{}
+
+			~SpatialHashGrid() override
+			{
+				SpatialHashGrid::Clear();
+			}
+
+			/**
+			 * \brief Reads the bounds of the nodes and calculates their new cells in parallel, afterwards the nodes that changed their cell are moved.
+			 */
+			void Update(Node* const* nodes, size_t count, WorkerPool* pool = nullptr) override
+			{
+				changes.resize(count);
+				const auto prepare = [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						Change& change = changes[i];
+						if (nodes[i]->drawables.empty())
+						{
+							change.cell = REMOVE_CELL;
+							continue;
+						}
+						nodes[i]->GetTransformStorage()->GetWorldBounds(nodes[i]->GetTransformIndex(), change.min, change.max);
+						change.cell = GetCell(change.min, change.max);
+						const uint32_t slot = nodes[i]->spatialIndexSlot;
+						if (slot != INVALID_SLOT && entries[slot].cell == change.cell)
+						{ // Every node is only passed once, so the entry is not shared with any other thread
+							entries[slot].min = change.min;
+							entries[slot].max = change.max;
+							change.cell = UNCHANGED_CELL;
+						}
+					}
+				};
+				if (pool) pool->ParallelFor(count, prepare, MIN_PARALLEL_CHUNK_SIZE);
+				else prepare(0, count);
+				for (size_t i = 0; i < count; i++)
+				{
+					if (changes[i].cell == UNCHANGED_CELL) continue;
+					if (changes[i].cell == REMOVE_CELL) Remove(nodes[i]);
+					else Place(nodes[i], changes[i]);
+				}
+			}
+
+			void Remove(Node* node) override
+			{
+				const uint32_t slot = node->spatialIndexSlot;
+				if (slot == INVALID_SLOT) return;
+				RemoveFromCell(slot);
+				const uint32_t last = static_cast<uint32_t>(entries.size() - 1);
+				if (slot != last)
+				{
+					entries[slot] = entries[last];
+					entries[slot].node->spatialIndexSlot = slot;
+					cells[entries[slot].cell][entries[slot].cellSlot] = slot;
+				}
+				entries.pop_back();
+				node->spatialIndexSlot = INVALID_SLOT;
+			}
+
+			void Clear() override
+			{
+				for (Entry& entry : entries)
+				{
+					entry.node->spatialIndexSlot = INVALID_SLOT;
+				}
+				entries.clear();
+				cells.clear();
+				occupiedMin = glm::vec3(INFINITY);
+				occupiedMax = glm::vec3(-INFINITY);
+			}
+
+			size_t Size() const override
+			{
+				return entries.size();
+			}
+
+			void QueryFrustum(const Math::Frustum& frustum, std::vector<Node*>& result) const override
+			{
+				Query([&frustum](const glm::vec3& min, const glm::vec3& max)
+				{
+					return frustum.IsVisible((min + max) * 0.5f, (max - min) * 0.5f);
+				}, [&result](const Entry& entry) { result.push_back(entry.node); });
+			}
+
+			void QueryAABB(const AABB& bounds, std::vector<Node*>& result) const override
+			{
+				const glm::vec3 boundsMin = bounds.GetMin(), boundsMax = bounds.GetMax();
+				const auto test = [&](const glm::vec3& min, const glm::vec3& max)
+				{
+					return min.x <= boundsMax.x && max.x >= boundsMin.x && min.y <= boundsMax.y && max.y >= boundsMin.y && min.z <= boundsMax.z && max.z >= boundsMin.z;
+				};
+				const auto visit = [&result](const Entry& entry) { result.push_back(entry.node); };
+				// Small boxes look up the cells they are touching, big ones check all the occupied cells
+				const glm::vec3 first = glm::floor((boundsMin - cellSize * 0.5f) * inverseCellSize);
+				const glm::vec3 last = glm::floor((boundsMax + cellSize * 0.5f) * inverseCellSize);
+				const glm::vec3 cellCount = last - first + 1.0f;
+				if (!(cellCount.x * cellCount.y * cellCount.z <= static_cast<float>(cells.size())) || !IsInGrid(first) || !IsInGrid(last))
+				{
+					Query(test, visit);
+					return;
+				}
+				for (int32_t x = static_cast<int32_t>(first.x); x <= static_cast<int32_t>(last.x); x++)
+				{
+					for (int32_t y = static_cast<int32_t>(first.y); y <= static_cast<int32_t>(last.y); y++)
+					{
+						for (int32_t z = static_cast<int32_t>(first.z); z <= static_cast<int32_t>(last.z); z++)
+						{
+							const auto cell = cells.find(Pack(x, y, z));
+							if (cell != cells.end()) QueryCell(cell->second, test, visit);
+						}
+					}
+				}
+				const uint64_t largeCell = LARGE_CELL; // find takes a reference
+				const auto large = cells.find(largeCell);
+				if (large != cells.end()) QueryCell(large->second, test, visit);
+			}
+
+			/**
+			 * \brief Walks along the ray through a grid that is offset by half a cell (3D DDA). Every cell of the offset grid overlaps
+			 * with the loose bounds of 2x2x2 cells, those are checked before the walk continues, so the nodes are visited roughly from near to far.
+			 */
+			void TraverseRay(const Math::Ray& ray, float maxDistance, const std::function<float(Node*, float)>& visitor) const override
+			{
+				float limit = maxDistance;
+				const auto visitCell = [&](const std::vector<uint32_t>& cell)
+				{
+					for (uint32_t slot : cell)
+					{
+						float distance;
+						if (ray.IntersectBox(entries[slot].min, entries[slot].max, limit, distance)) limit = visitor(entries[slot].node, distance);
+					}
+				};
+				const uint64_t largeCell = LARGE_CELL; // find takes a reference
+				const auto large = cells.find(largeCell);
+				if (large != cells.end()) visitCell(large->second);
+				float distance, exitDistance;
+				if (!ray.IntersectBox(occupiedMin, occupiedMax, limit, distance, exitDistance)) return;
+				const glm::vec3 start = glm::floor(ray.GetPoint(distance) * inverseCellSize + 0.5f);
+				const glm::vec3 end = glm::floor(ray.GetPoint(exitDistance) * inverseCellSize + 0.5f);
+				const glm::vec3 steps = glm::abs(end - start);
+				if (!IsInGrid(start) || !IsInGrid(end) || steps.x + steps.y + steps.z > static_cast<float>(cells.size()))
+				{ // Walking would take longer than checking all the occupied cells
+					for (const auto& cell : cells)
+					{
+						glm::vec3 min, max;
+						if (cell.first == LARGE_CELL) continue;
+						GetCellBounds(cell.first, min, max);
+						if (ray.IntersectBox(min, max, limit, distance)) visitCell(cell.second);
+					}
+					return;
+				}
+				int32_t coordinates[3], step[3];
+				float nextDistance[3], deltaDistance[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					coordinates[axis] = static_cast<int32_t>(start[axis]);
+					step[axis] = (ray.direction[axis] > 0) ? 1 : ((ray.direction[axis] < 0) ? -1 : 0);
+					deltaDistance[axis] = step[axis] ? cellSize * std::abs(ray.inverseDirection[axis]) : INFINITY;
+					const float boundary = (coordinates[axis] + step[axis] * 0.5f) * cellSize;
+					nextDistance[axis] = step[axis] ? (boundary - ray.origin[axis]) * ray.inverseDirection[axis] : INFINITY;
+				}
+				// A cell stays inside of the 2x2x2 block of the walk for at most 4 steps, so only the cells of the last 3 steps need to be remembered
+				uint64_t visited[24];
+				uint32_t visitedCount = 0;
+				const int32_t remaining[3] = { static_cast<int32_t>(steps.x), static_cast<int32_t>(steps.y), static_cast<int32_t>(steps.z) };
+				int32_t taken[3] = { 0, 0, 0 };
+				while (distance <= limit)
+				{
+					for (int32_t i = 0; i < 8; i++)
+					{
+						const uint64_t key = Pack(coordinates[0] - (i & 1), coordinates[1] - ((i >> 1) & 1), coordinates[2] - ((i >> 2) & 1));
+						if (std::find(visited, visited + std::min<uint32_t>(visitedCount, 24), key) != visited + std::min<uint32_t>(visitedCount, 24)) continue;
+						visited[visitedCount++ % 24] = key;
+						const auto cell = cells.find(key);
+						if (cell != cells.end()) visitCell(cell->second);
+					}
+					const int axis = (nextDistance[0] < nextDistance[1]) ? ((nextDistance[0] < nextDistance[2]) ? 0 : 2) : ((nextDistance[1] < nextDistance[2]) ? 1 : 2);
+					if (taken[axis] > remaining[axis]) break; // Left the occupied bounds, one extra step in case the end has been rounded down
+					distance = nextDistance[axis];
+					nextDistance[axis] += deltaDistance[axis];
+					coordinates[axis] += step[axis];
+					taken[axis]++;
+				}
+			}
+
+			float GetCellSize() const
+			{
+				return cellSize;
+			}
+
+		private:
+			static bool IsInGrid(const glm::vec3& coordinates)
+			{ // Also false for NaN
+				const float limit = static_cast<float>(COORDINATE_LIMIT);
+				return std::abs(coordinates.x) < limit && std::abs(coordinates.y) < limit && std::abs(coordinates.z) < limit;
+			}
+
+			static uint64_t Pack(int32_t x, int32_t y, int32_t z)
+			{
+				return ((static_cast<uint64_t>(x) & COORDINATE_MASK) << (2 * COORDINATE_BITS)) | ((static_cast<uint64_t>(y) & COORDINATE_MASK) << COORDINATE_BITS) | (static_cast<uint64_t>(z) & COORDINATE_MASK);
+			}
+
+			static int32_t Unpack(uint64_t key, int32_t shift)
+			{ // Sign extend the coordinate
+				const int32_t value = static_cast<int32_t>((key >> shift) & COORDINATE_MASK);
+				return (value & COORDINATE_LIMIT) ? value - 2 * COORDINATE_LIMIT : value;
+			}
+
+			uint64_t GetCell(const glm::vec3& min, const glm::vec3& max) const
+			{
+				const glm::vec3 size = max - min;
+				if (size.x > cellSize || size.y > cellSize || size.z > cellSize) return LARGE_CELL;
+				const glm::vec3 coordinates = glm::floor((min + max) * 0.5f * inverseCellSize);
+				if (!IsInGrid(coordinates)) return LARGE_CELL;
+				return Pack(static_cast<int32_t>(coordinates.x), static_cast<int32_t>(coordinates.y), static_cast<int32_t>(coordinates.z));
+			}
+
+			/**
+			 * \brief Gets the loose bounds of a cell, the cell itself grown by half a cell in every direction.
+			 */
+			void GetCellBounds(uint64_t key, glm::vec3& min, glm::vec3& max) const
+			{
+				const glm::vec3 coordinates(Unpack(key, 2 * COORDINATE_BITS), Unpack(key, COORDINATE_BITS), Unpack(key, 0));
+				min = coordinates * cellSize - cellSize * 0.5f;
+				max = min + cellSize * 2.0f;
+			}
+
+			void Place(Node* node, const Change& change)
+			{
+				uint32_t slot = node->spatialIndexSlot;
+				if (slot == INVALID_SLOT)
+				{
+					slot = static_cast<uint32_t>(entries.size());
+					entries.emplace_back();
+					entries[slot].node = node;
+					node->spatialIndexSlot = slot;
+				}
+				else RemoveFromCell(slot);
+				Entry& entry = entries[slot];
+				std::vector<uint32_t>& cell = cells[change.cell];
+				entry.min = change.min;
+				entry.max = change.max;
+				entry.cell = change.cell;
+				entry.cellSlot = static_cast<uint32_t>(cell.size());
+				cell.push_back(slot);
+				if (change.cell != LARGE_CELL)
+				{
+					glm::vec3 min, max;
+					GetCellBounds(change.cell, min, max);
+					occupiedMin = glm::min(occupiedMin, min);
+					occupiedMax = glm::max(occupiedMax, max);
+				}
+			}
+
+			void RemoveFromCell(uint32_t slot)
+			{
+				const Entry& entry = entries[slot];
+				const auto cell = cells.find(entry.cell);
+				std::vector<uint32_t>& cellEntries = cell->second;
+				cellEntries[entry.cellSlot] = cellEntries.back();
+				entries[cellEntries[entry.cellSlot]].cellSlot = entry.cellSlot;
+				cellEntries.pop_back();
+				if (cellEntries.empty()) cells.erase(cell);
+			}
+
+			template<typename Test, typename Visit>
+			void QueryCell(const std::vector<uint32_t>& cell, const Test& test, const Visit& visit) const
+			{
+				for (uint32_t slot : cell)
+				{
+					const Entry& entry = entries[slot];
+					if (test(entry.min, entry.max)) visit(entry);
+				}
+			}
+
+			/**
+			 * \brief Runs a query on all the occupied cells. Cells whose loose bounds fail the test are skipped.
+			 */
+			template<typename Test, typename Visit>
+			void Query(const Test& test, const Visit& visit) const
+			{
+				for (const auto& cell : cells)
+				{
+					if (cell.first != LARGE_CELL)
+					{
+						glm::vec3 min, max;
+						GetCellBounds(cell.first, min, max);
+						if (!test(min, max)) continue;
+					}
+					QueryCell(cell.second, test, visit);
+				}
+			}
+		};
+	}
+}
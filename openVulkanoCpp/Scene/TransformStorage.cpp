@@ -0,0 +1,147 @@
+#include "TransformStorage.hpp"
+#include "Node.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		constexpr uint32_t TransformStorage::INVALID_INDEX;
+
+		TransformStorage::~TransformStorage()
+		{
+			for (Node* node : nodes)
+			{
+				if (!node) continue;
+				node->transforms = nullptr;
+				node->transformIndex = INVALID_INDEX;
+			}
+		}
+
+		uint32_t TransformStorage::ValidateNodes(Node* const* nodes, size_t count) const
+		{
+			uint32_t first = INVALID_INDEX;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (nodes[i]->transforms != this) throw std::runtime_error("Node is not part of the transform storage!");
+				first = std::min(first, nodes[i]->transformIndex);
+			}
+			return first;
+		}
+
+		void TransformStorage::SetLocalMatrices(Node* const* nodes, const glm::mat4x4* mats, size_t count)
+		{
+			const uint32_t first = ValidateNodes(nodes, count);
+			for (size_t i = 0; i < count; i++)
+			{
+				const uint32_t index = nodes[i]->transformIndex;
+				localMats[index] = mats[i];
+				localStates[index] = LOCAL_MATRIX;
+				dirty[index] = 1;
+			}
+			MergeFirstDirty(first);
+		}
+
+		void TransformStorage::SetPositions(Node* const* nodes, const glm::vec3* positions, size_t count)
+		{
+			const uint32_t first = ValidateNodes(nodes, count);
+			for (size_t i = 0; i < count; i++)
+			{
+				const uint32_t index = nodes[i]->transformIndex;
+				if (localStates[index] == LOCAL_MATRIX) DecomposeLocalMatrix(index);
+				trs[index].position = positions[i];
+				localStates[index] = LOCAL_TRS_CHANGED;
+				dirty[index] = 1;
+			}
+			MergeFirstDirty(first);
+		}
+
+		void TransformStorage::Compact()
+		{
+			if (!freeCount) return;
+			std::vector<uint32_t> order;
+			order.reserve(nodes.size() - freeCount);
+			for (uint32_t i = 0; i < nodes.size(); i++)
+			{
+				if (nodes[i]) order.push_back(i);
+			}
+			ApplyOrder(order);
+		}
+
+		void TransformStorage::SortByDepth()
+		{
+			// Breadth first traversal, the children of every entry are appended in the order their parents have in the level before
+			std::vector<std::vector<uint32_t>> children(nodes.size());
+			std::vector<uint32_t> order;
+			order.reserve(nodes.size() - freeCount);
+			for (uint32_t i = 0; i < nodes.size(); i++)
+			{
+				if (!nodes[i]) continue;
+				if (parents[i] == INVALID_INDEX || !nodes[parents[i]]) order.push_back(i);
+				else children[parents[i]].push_back(i);
+			}
+			levelOffsets.assign(1, 0);
+			size_t levelBegin = 0;
+			while (levelBegin < order.size())
+			{
+				const size_t levelEnd = order.size();
+				levelOffsets.push_back(static_cast<uint32_t>(levelEnd));
+				for (size_t i = levelBegin; i < levelEnd; i++)
+				{
+					order.insert(order.end(), children[order[i]].begin(), children[order[i]].end());
+				}
+				levelBegin = levelEnd;
+			}
+			ApplyOrder(order);
+			levelsDirty = false;
+		}
+
+		void TransformStorage::ApplyOrder(const std::vector<uint32_t>& order)
+		{
+			std::vector<uint32_t> remap(nodes.size(), INVALID_INDEX);
+			for (uint32_t i = 0; i < order.size(); i++)
+			{
+				remap[order[i]] = i;
+			}
+			MatrixArray newLocalMats(order.size()), newWorldMats(order.size());
+			std::vector<uint32_t> newParents(order.size()), newDepths(order.size());
+			std::vector<Node*> newNodes(order.size());
+			std::vector<uint8_t> newDirty(order.size()), newLocalStates(order.size());
+			std::vector<Trs> newTrs(order.size());
+			std::vector<glm::vec3> newLocalBoundsCenters(order.size()), newLocalBoundsExtents(order.size());
+			Math::BoundsArray newWorldBounds;
+			newWorldBounds.Resize(order.size());
+			uint32_t newFirstDirty = INVALID_INDEX;
+			for (uint32_t i = 0; i < order.size(); i++)
+			{
+				const uint32_t old = order[i];
+				newLocalMats[i] = localMats[old];
+				newWorldMats[i] = worldMats[old];
+				newParents[i] = (parents[old] != INVALID_INDEX) ? remap[parents[old]] : INVALID_INDEX;
+				newDepths[i] = (newParents[i] != INVALID_INDEX) ? newDepths[newParents[i]] + 1 : 0;
+				newNodes[i] = nodes[old];
+				newDirty[i] = dirty[old];
+				newLocalStates[i] = localStates[old];
+				newTrs[i] = trs[old];
+				newLocalBoundsCenters[i] = localBoundsCenters[old];
+				newLocalBoundsExtents[i] = localBoundsExtents[old];
+				newWorldBounds.Set(i, worldBounds.GetCenter(old), worldBounds.GetExtent(old));
+				if (newDirty[i] && newFirstDirty == INVALID_INDEX) newFirstDirty = i;
+				newNodes[i]->transformIndex = i;
+			}
+			localMats.swap(newLocalMats);
+			worldMats.swap(newWorldMats);
+			parents.swap(newParents);
+			depths.swap(newDepths);
+			nodes.swap(newNodes);
+			dirty.swap(newDirty);
+			localStates.swap(newLocalStates);
+			trs.swap(newTrs);
+			localBoundsCenters.swap(newLocalBoundsCenters);
+			localBoundsExtents.swap(newLocalBoundsExtents);
+			std::swap(worldBounds, newWorldBounds);
+			firstDirty = newFirstDirty;
+			freeCount = 0;
+			levelsDirty = true;
+		}
+	}
+}
@@ -0,0 +1,548 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../Data/AlignedAllocator.hpp"
+#include "../Base/WorkerPool.hpp"
+#include "../Math/MatrixBatch.hpp"
+#include "../Math/BoundsArray.hpp"
+#include "../Math/Frustum.hpp"
+#include "AABB.hpp"
+#include "ISpatialIndex.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Scene
+	{
+		struct Node;
+
+		/**
+		 * \brief Stores the transformations of all the nodes of a scene in flat arrays (structure of arrays).
+		 * The entries are ordered so that parents always come before their children,
+		 * which allows to update all the world matrices with a single linear pass.
+		 */
+		class TransformStorage final
+		{
+		public:
+			typedef std::vector<glm::mat4x4, Data::AlignedAllocator<glm::mat4x4, 64>> MatrixArray;
+			static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+			/**
+			 * \brief Compact transformation made of a translation, a rotation and an uniform scale.
+			 */
+			struct Trs
+			{
+				glm::quat rotation = glm::quat(1, 0, 0, 0);
+				glm::vec3 position = glm::vec3(0);
+				float scale = 1;
+			};
+
+		private:
+			static constexpr uint32_t MIN_COMPACT_SIZE = 1024;
+			static constexpr uint32_t MIN_PARALLEL_CHUNK_SIZE = 512;
+			static constexpr uint32_t MIN_CULL_CHUNK_SIZE = 4096;
+
+			enum LocalState : uint8_t
+			{
+				LOCAL_MATRIX = 0, // The local matrix has been set directly
+				LOCAL_TRS, // The local matrix is composed from the trs, it is up to date
+				LOCAL_TRS_CHANGED // The local matrix is composed from the trs, it needs to be recomposed
+			};
+
+			MatrixArray localMats, worldMats;
+			std::vector<uint32_t> parents, depths;
+			std::vector<Node*> nodes;
+			std::vector<uint8_t> dirty, localStates;
+			std::vector<Trs> trs;
+			std::vector<glm::vec3> localBoundsCenters, localBoundsExtents;
+			Math::BoundsArray worldBounds;
+			std::vector<uint32_t> levelOffsets;
+			uint32_t firstDirty = INVALID_INDEX, freeCount = 0;
+			uint32_t nextStableId = 0;
+			bool levelsDirty = false;
+			ISpatialIndex* spatialIndex = nullptr;
+			std::vector<Node*> changedNodes;
+			std::mutex bulkMutex;
+
+		public:
+			TransformStorage() = default;
+			TransformStorage(const TransformStorage&) = delete;
+			TransformStorage& operator=(const TransformStorage&) = delete;
+			~TransformStorage();
+
+			/**
+			 * \brief Gets the storage that is used for all the nodes that are not part of a scene.
+			 */
+			static TransformStorage* GetDetachedStorage()
+			{
+				static TransformStorage* storage = new TransformStorage();
+				return storage;
+			}
+
+			/**
+			 * \brief Sets the spatial index that should be kept up to date with the world bounds of the entries.
+			 * Changed entries will be passed to it at the end of every Update, removed entries immediately.
+			 */
+			void SetSpatialIndex(ISpatialIndex* spatialIndex)
+			{
+				this->spatialIndex = spatialIndex;
+			}
+
+			void Reserve(size_t size)
+			{
+				localMats.reserve(size);
+				worldMats.reserve(size);
+				parents.reserve(size);
+				depths.reserve(size);
+				nodes.reserve(size);
+				dirty.reserve(size);
+				localStates.reserve(size);
+				trs.reserve(size);
+				localBoundsCenters.reserve(size);
+				localBoundsExtents.reserve(size);
+				worldBounds.Reserve(size);
+			}
+
+			/**
+			 * \brief Adds a new entry at the end of the storage.
+			 * \param node The node that owns the entry. The nodes transformIndex will be kept up to date by the storage.
+			 * \param parentIndex The index of the parent entry or INVALID_INDEX. The parent must already be part of the storage.
+			 * \param localMat The local matrix of the entry
+			 * \return The index of the new entry
+			 */
+			uint32_t Add(Node* node, uint32_t parentIndex, const glm::mat4x4& localMat)
+			{
+				const uint32_t index = static_cast<uint32_t>(nodes.size());
+				localMats.push_back(localMat);
+				worldMats.push_back(localMat);
+				parents.push_back(parentIndex);
+				depths.push_back((parentIndex != INVALID_INDEX) ? depths[parentIndex] + 1 : 0);
+				nodes.push_back(node);
+				dirty.push_back(1);
+				localStates.push_back(LOCAL_MATRIX);
+				trs.emplace_back();
+				localBoundsCenters.emplace_back(0);
+				localBoundsExtents.emplace_back(0);
+				worldBounds.PushBack(glm::vec3(0), glm::vec3(0));
+				if (index < firstDirty) firstDirty = index;
+				levelsDirty = true;
+				return index;
+			}
+
+			/**
+			 * \brief Frees an entry. The slot will be reclaimed the next time the storage gets compacted.
+			 */
+			void Remove(uint32_t index)
+			{
+				if (spatialIndex) spatialIndex->Remove(nodes[index]);
+				nodes[index] = nullptr;
+				parents[index] = INVALID_INDEX;
+				dirty[index] = 0;
+				freeCount++;
+				levelsDirty = true;
+			}
+
+			/**
+			 * \brief Marks an entry as changed, so it will be updated and reported by the next Update.
+			 */
+			void Invalidate(uint32_t index)
+			{
+				MarkDirty(index);
+			}
+
+			void SetLocalMatrix(uint32_t index, const glm::mat4x4& mat)
+			{
+				localMats[index] = mat;
+				localStates[index] = LOCAL_MATRIX;
+				MarkDirty(index);
+			}
+
+			/**
+			 * \brief Sets the local matrices of a continuous range of entries.
+			 * Calls on disjoint ranges may be done from multiple threads at the same time.
+			 * \param first The index of the first entry of the range
+			 * \param mats The new local matrices, one per entry of the range
+			 * \param count The size of the range
+			 */
+			void SetLocalMatrices(uint32_t first, const glm::mat4x4* mats, size_t count)
+			{
+				if (!count) return;
+				std::copy(mats, mats + count, localMats.begin() + first);
+				std::fill_n(localStates.begin() + first, count, LOCAL_MATRIX);
+				std::fill_n(dirty.begin() + first, count, 1);
+				MergeFirstDirty(first);
+			}
+
+			/**
+			 * \brief Sets the local matrices of multiple nodes. All the nodes are validated before anything gets changed.
+			 * Calls with disjoint sets of nodes may be done from multiple threads at the same time.
+			 * \throws std::runtime_error If one of the nodes is not part of this storage
+			 */
+			void SetLocalMatrices(Node* const* nodes, const glm::mat4x4* mats, size_t count);
+
+			/**
+			 * \brief Sets the positions of multiple nodes, the nodes will use a trs. Works like SetLocalMatrices.
+			 */
+			void SetPositions(Node* const* nodes, const glm::vec3* positions, size_t count);
+
+			/**
+			 * \brief Sets the bounds of an entry in its local space. The world bounds will be updated together with the world matrix.
+			 * \param bounds The local bounds, an empty AABB will be stored as a point at the origin
+			 */
+			void SetLocalBounds(uint32_t index, const AABB& bounds)
+			{
+				if (bounds.IsEmpty()) SetLocalBounds(index, glm::vec3(0), glm::vec3(0));
+				else SetLocalBounds(index, bounds.GetCenter(), bounds.GetDiagonal() * 0.5f);
+			}
+
+			void SetLocalBounds(uint32_t index, const glm::vec3& center, const glm::vec3& extent)
+			{
+				localBoundsCenters[index] = center;
+				localBoundsExtents[index] = extent;
+				MarkDirty(index);
+			}
+
+			const glm::vec3& GetLocalBoundsCenter(uint32_t index) const
+			{
+				return localBoundsCenters[index];
+			}
+
+			const glm::vec3& GetLocalBoundsExtent(uint32_t index) const
+			{
+				return localBoundsExtents[index];
+			}
+
+			/**
+			 * \brief Gets the world space bounds of all the entries. They are only up to date after Update.
+			 */
+			const Math::BoundsArray& GetWorldBounds() const
+			{
+				return worldBounds;
+			}
+
+			/**
+			 * \brief Gets the world bounds of an entry as minimum and maximum. They are only up to date after Update.
+			 */
+			void GetWorldBounds(uint32_t index, glm::vec3& min, glm::vec3& max) const
+			{
+				const glm::vec3 center = worldBounds.GetCenter(index), extent = worldBounds.GetExtent(index);
+				min = center - extent;
+				max = center + extent;
+			}
+
+			/**
+			 * \brief Checks the world bounds of all the entries against a frustum.
+			 * \param frustum The frustum to check against
+			 * \param visible Receives 1 for every visible entry and 0 for every culled entry, it must be able to hold Size() entries
+			 * \param pool Optional worker pool to split the entries between multiple threads
+			 */
+			void Cull(const Math::Frustum& frustum, uint8_t* visible, WorkerPool* pool = nullptr) const
+			{
+				if (!pool)
+				{
+					frustum.Cull(worldBounds, 0, nodes.size(), visible);
+					return;
+				}
+				pool->ParallelFor(nodes.size(), [&](size_t begin, size_t end)
+				{
+					frustum.Cull(worldBounds, begin, end, visible);
+				}, MIN_CULL_CHUNK_SIZE);
+			}
+
+			/**
+			 * \brief Gets the local matrix of an entry. If the entry uses a trs that has been changed, the matrix will be composed first.
+			 */
+			const glm::mat4x4& GetLocalMatrix(uint32_t index)
+			{
+				if (localStates[index] == LOCAL_TRS_CHANGED) ComposeLocalMatrix(index);
+				return localMats[index];
+			}
+
+			/**
+			 * \brief Sets the trs of an entry. The local matrix will be composed lazily the next time it is needed.
+			 */
+			void SetTrs(uint32_t index, const Trs& transform)
+			{
+				trs[index] = transform;
+				localStates[index] = LOCAL_TRS_CHANGED;
+				MarkDirty(index);
+			}
+
+			/**
+			 * \brief Gets the trs of an entry. If the local matrix of the entry has been set directly, the trs will be extracted from it.
+			 * Shear and non uniform scale can not be represented by a trs and will be lost.
+			 */
+			const Trs& GetTrs(uint32_t index)
+			{
+				if (localStates[index] == LOCAL_MATRIX) DecomposeLocalMatrix(index);
+				return trs[index];
+			}
+
+			bool UsesTrs(uint32_t index) const
+			{
+				return localStates[index] != LOCAL_MATRIX;
+			}
+
+			void SetPosition(uint32_t index, const glm::vec3& position)
+			{
+				if (localStates[index] == LOCAL_MATRIX) DecomposeLocalMatrix(index);
+				trs[index].position = position;
+				localStates[index] = LOCAL_TRS_CHANGED;
+				MarkDirty(index);
+			}
+
+			void SetRotation(uint32_t index, const glm::quat& rotation)
+			{
+				if (localStates[index] == LOCAL_MATRIX) DecomposeLocalMatrix(index);
+				trs[index].rotation = rotation;
+				localStates[index] = LOCAL_TRS_CHANGED;
+				MarkDirty(index);
+			}
+
+			void SetScale(uint32_t index, float scale)
+			{
+				if (localStates[index] == LOCAL_MATRIX) DecomposeLocalMatrix(index);
+				trs[index].scale = scale;
+				localStates[index] = LOCAL_TRS_CHANGED;
+				MarkDirty(index);
+			}
+
+			/**
+			 * \brief Gets the world matrix of an entry. If the entry or one of its parents is dirty, the world matrices of the chain will be recalculated.
+			 * The dirty flags will not be cleared, so the children will still be updated by the next Update.
+			 */
+			const glm::mat4x4& GetWorldMatrix(uint32_t index)
+			{
+				if (firstDirty <= index) ResolveChain(index);
+				return worldMats[index];
+			}
+
+			/**
+			 * \brief Checks if the world matrix of an entry is outdated.
+			 */
+			bool IsDirty(uint32_t index) const
+			{
+				for (; index != INVALID_INDEX && index >= firstDirty; index = parents[index])
+				{
+					if (dirty[index]) return true;
+				}
+				return false;
+			}
+
+			uint32_t GetParent(uint32_t index) const
+			{
+				return parents[index];
+			}
+
+			uint32_t GetDepth(uint32_t index) const
+			{
+				return depths[index];
+			}
+
+			Node* GetNode(uint32_t index) const
+			{
+				return nodes[index];
+			}
+
+			size_t Size() const
+			{
+				return nodes.size();
+			}
+
+			/**
+			 * \brief Hands out the next stable id of a node. Unlike the indices, the ids never change while a node is part of the storage.
+			 */
+			uint32_t AllocateStableId()
+			{
+				return nextStableId++;
+			}
+
+			/**
+			 * \brief Gets the amount of stable ids that have been handed out, all the ids are smaller than it.
+			 */
+			uint32_t GetStableIdCount() const
+			{
+				return nextStableId;
+			}
+
+			/**
+			 * \brief Starts handing out the stable ids from 0 again. Must only be called while no node uses an id of this storage.
+			 */
+			void ResetStableIds()
+			{
+				nextStableId = 0;
+			}
+
+			const glm::mat4x4* GetWorldMatrices() const
+			{
+				return worldMats.data();
+			}
+
+			/**
+			 * \brief Gets the local matrices of all the entries. Entries with a changed trs will only be up to date after the next Update.
+			 */
+			const glm::mat4x4* GetLocalMatrices() const
+			{
+				return localMats.data();
+			}
+
+			/**
+			 * \brief Recalculates the world matrices of all the dirty entries and their children.
+			 * Only the range starting at the first dirty entry will be processed.
+			 */
+			void Update()
+			{
+				if (freeCount >= MIN_COMPACT_SIZE && freeCount * 4 >= nodes.size()) Compact();
+				if (firstDirty == INVALID_INDEX) return;
+				const size_t size = nodes.size();
+				UpdateRange(firstDirty, size);
+				ClearDirty(nullptr);
+			}
+
+			/**
+			 * \brief Recalculates the world matrices of all the dirty entries and their children using multiple threads.
+			 * The entries are processed level by level (by their depth in the hierarchy), every level is split between the threads of the pool.
+			 * \param pool The worker pool that should be used. Levels that are too small to be worth splitting will be processed by the calling thread.
+			 */
+			void Update(WorkerPool* pool)
+			{
+				if (!pool || pool->GetThreadCount() < 2)
+				{
+					Update();
+					return;
+				}
+				if (levelsDirty) SortByDepth();
+				if (firstDirty == INVALID_INDEX) return;
+				const uint32_t firstLevel = depths[firstDirty];
+				for (size_t level = firstLevel; level + 1 < levelOffsets.size(); level++)
+				{
+					const size_t begin = std::max<size_t>(levelOffsets[level], firstDirty), end = levelOffsets[level + 1];
+					if (begin >= end) continue;
+					pool->ParallelFor(end - begin, [&](size_t chunkBegin, size_t chunkEnd)
+					{
+						UpdateRange(begin + chunkBegin, begin + chunkEnd);
+					}, MIN_PARALLEL_CHUNK_SIZE);
+				}
+				ClearDirty(pool);
+			}
+
+			/**
+			 * \brief Removes all the free slots from the storage. The order of the remaining entries will be preserved.
+			 */
+			void Compact();
+
+			/**
+			 * \brief Removes all the free slots from the storage and sorts the entries by their depth in the hierarchy,
+			 * so that every level is a continuous range. Children of the same parent will be next to each other.
+			 */
+			void SortByDepth();
+
+		private:
+			/**
+			 * \brief Reorders the entries of the storage.
+			 * \param order The old indices of the entries in their new order. Entries not contained will be dropped.
+			 */
+			void ApplyOrder(const std::vector<uint32_t>& order);
+
+			/**
+			 * \brief Clears the dirty flags after an update. All the entries that have been updated will be reported to the spatial index.
+			 */
+			void ClearDirty(WorkerPool* pool)
+			{
+				if (spatialIndex)
+				{
+					changedNodes.clear();
+					for (size_t i = firstDirty; i < nodes.size(); i++)
+					{
+						if (dirty[i]) changedNodes.push_back(nodes[i]);
+					}
+					spatialIndex->Update(changedNodes.data(), changedNodes.size(), pool);
+				}
+				std::fill(dirty.begin() + firstDirty, dirty.end(), 0);
+				firstDirty = INVALID_INDEX;
+			}
+
+			/**
+			 * \brief Validates that all the nodes are part of this storage and returns the smallest index of them.
+			 */
+			uint32_t ValidateNodes(Node* const* nodes, size_t count) const;
+
+			void MergeFirstDirty(uint32_t index)
+			{
+				std::lock_guard<std::mutex> lock(bulkMutex);
+				if (index < firstDirty) firstDirty = index;
+			}
+
+			void MarkDirty(uint32_t index)
+			{
+				dirty[index] = 1;
+				if (index < firstDirty) firstDirty = index;
+			}
+
+			void ComposeLocalMatrix(uint32_t index)
+			{
+				const Trs& transform = trs[index];
+				glm::mat4x4& mat = localMats[index];
+				mat = glm::mat4_cast(transform.rotation);
+				mat[0] *= transform.scale;
+				mat[1] *= transform.scale;
+				mat[2] *= transform.scale;
+				mat[3] = glm::vec4(transform.position, 1);
+				localStates[index] = LOCAL_TRS;
+			}
+
+			void DecomposeLocalMatrix(uint32_t index)
+			{
+				const glm::mat4x4& mat = localMats[index];
+				Trs& transform = trs[index];
+				transform.position = glm::vec3(mat[3]);
+				transform.scale = glm::length(glm::vec3(mat[0]));
+				transform.rotation = glm::quat_cast(glm::mat3x3(mat) / ((transform.scale != 0) ? transform.scale : 1.0f));
+			}
+
+			/**
+			 * \brief Updates the world matrices of a range. Continuous runs of dirty siblings will be multiplied with their parent in one batch.
+			 */
+			void UpdateRange(size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end;)
+				{
+					const uint32_t parent = parents[i];
+					const uint8_t parentDirty = (parent != INVALID_INDEX) ? dirty[parent] : 0;
+					size_t runEnd = i;
+					while (runEnd < end && parents[runEnd] == parent && (dirty[runEnd] |= parentDirty))
+					{
+						if (localStates[runEnd] == LOCAL_TRS_CHANGED) ComposeLocalMatrix(static_cast<uint32_t>(runEnd));
+						runEnd++;
+					}
+					if (runEnd == i)
+					{
+						i++;
+						continue;
+					}
+					if (parent != INVALID_INDEX) Math::MatrixBatch::Multiply(worldMats[parent], &localMats[i], &worldMats[i], runEnd - i);
+					else std::copy(localMats.begin() + i, localMats.begin() + runEnd, worldMats.begin() + i);
+					for (; i < runEnd; i++)
+					{
+						glm::vec3 center, extent;
+						Math::BoundsArray::Transform(worldMats[i], localBoundsCenters[i], localBoundsExtents[i], center, extent);
+						worldBounds.Set(i, center, extent);
+					}
+				}
+			}
+
+			bool ResolveChain(uint32_t index)
+			{
+				const uint32_t parent = parents[index];
+				bool changed = dirty[index];
+				if (parent != INVALID_INDEX && parent >= firstDirty) changed |= ResolveChain(parent);
+				if (localStates[index] == LOCAL_TRS_CHANGED) ComposeLocalMatrix(index);
+				if (changed) worldMats[index] = (parent != INVALID_INDEX) ? worldMats[parent] * localMats[index] : localMats[index];
+				return changed;
+			}
+		};
+	}
+}
@@ -3,5 +3,13 @@ pushd %~dp0
 
 glslangvalidator -V basic.vert -o basic.vert.spv
 glslangvalidator -V basic.frag -o basic.frag.spv
+glslangvalidator -V basicIndirect.vert -o basicIndirect.vert.spv
+glslangvalidator -V cull.comp -o cull.comp.spv
+glslangvalidator -V occlusionBox.vert -o occlusionBox.vert.spv
+
+REM Validate the compiled shaders, the build fails on invalid SPIR-V.
+for %%s in (*.spv) do (
+	spirv-val %%s || exit /b 1
+)
 
 popd
\ No newline at end of file
@@ -9,10 +9,8 @@ layout(location = 4) in vec3 textureCoordinates;
 layout(location = 5) in vec4 color;
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 0) uniform NodeData
-{
-	mat4 world;
-} node;
+// The world matrices of all nodes of the draw list, the instance index of a draw selects the matrix of its node
+layout(std430, binding = 0) readonly buffer Instances { mat4 worlds[]; };
 
 layout(std140, push_constant) uniform CameraData {
     mat4 viewProjection;
@@ -20,9 +18,10 @@ layout(std140, push_constant) uniform CameraData {
 
 void main()
 {
+	mat4 world = worlds[gl_InstanceIndex];
 	vec3 light = normalize(vec3(1));
-	vec4 worldPos = node.world * vec4(position, 1.0);
-    vec3 worldNormal = normalize(transpose(inverse(mat3(node.world))) * normal);
+	vec4 worldPos = world * vec4(position, 1.0);
+    vec3 worldNormal = normalize(transpose(inverse(mat3(world))) * normal);
     float brightness = max(0.0, dot(worldNormal, light));
     outColor = vec4(clamp(color.rgb * (0.5 + brightness / 2), 0, 1), 1);
 	gl_Position = normalize(cam.viewProjection *  worldPos);
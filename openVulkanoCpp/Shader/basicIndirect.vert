@@ -0,0 +1,40 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec3 tangent;
+layout(location = 3) in vec3 biTangent;
+layout(location = 4) in vec3 textureCoordinates;
+layout(location = 5) in vec4 color;
+layout(location = 0) out vec4 outColor;
+
+struct Instance
+{
+	mat4 world;
+	vec4 center;
+	vec4 extent;
+	uint drawIndex;
+	uint visibleBase;
+	uint potentiallyVisible;
+	uint padding;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 2) readonly buffer Visible { uint visible[]; };
+
+layout(std140, push_constant) uniform CameraData {
+    mat4 viewProjection;
+    uint visibleBase; // The first entry of the drawable in the visible list
+} cam;
+
+void main()
+{
+	mat4 world = instances[visible[cam.visibleBase + gl_InstanceIndex]].world;
+	vec3 light = normalize(vec3(1));
+	vec4 worldPos = world * vec4(position, 1.0);
+    vec3 worldNormal = normalize(transpose(inverse(mat3(world))) * normal);
+    float brightness = max(0.0, dot(worldNormal, light));
+    outColor = vec4(clamp(color.rgb * (0.5 + brightness / 2), 0, 1), 1);
+	gl_Position = normalize(cam.viewProjection *  worldPos);
+}
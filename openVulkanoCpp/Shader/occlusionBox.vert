@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(std140, push_constant) uniform BoxData {
+    mat4 viewProjection;
+    vec4 center;
+    vec4 extent;
+} box;
+
+// The 12 triangles of a box, bit 0, 1 and 2 of a corner select the sign of the x, y and z extent
+// The vertex count must match OcclusionQueries::BOX_VERTEX_COUNT
+const int corners[36] = int[36](0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3);
+
+void main()
+{
+	int corner = corners[gl_VertexIndex];
+	vec3 direction = vec3((corner & 1) != 0 ? 1.0 : -1.0, (corner & 2) != 0 ? 1.0 : -1.0, (corner & 4) != 0 ? 1.0 : -1.0);
+	gl_Position = box.viewProjection * vec4(box.center.xyz + box.extent.xyz * direction, 1.0);
+}
@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include "../Data/BalancedArrayQueues.hpp"
+
+using namespace openVulkanoCpp::Data;
+
+#define CHECK(condition) if (!(condition)) { std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); return 1; }
+
+/**
+ * \brief Pops the whole own range of a consumer without stealing, returns the amount of popped elements.
+ */
+static size_t PopOwnRange(BalancedArrayQueues<int>& queues, uint32_t consumer, std::vector<int>& popCounts, const int* data)
+{
+	size_t popped = 0, count;
+	bool stolen;
+	while (queues.GetRemaining(consumer) > 0)
+	{
+		int* first = queues.Pop(consumer, count, 1, stolen);
+		for (size_t i = 0; i < count; i++) popCounts[first - data + i]++;
+		popped += count;
+	}
+	return popped;
+}
+
+/**
+ * \brief One consumer starts late, the others empty their own ranges and steal from it. Only the cost the late consumer popped itself
+ * is credited to it, so its range has to shrink on the next partition.
+ */
+static int TestLateConsumerRangeShrinks()
+{
+	const uint32_t CONSUMERS = 4;
+	std::vector<int> data(400, 1);
+	BalancedArrayQueues<int> queues;
+	queues.Init(CONSUMERS);
+	queues.Partition(data.data(), data.size(), [](size_t) { return 1.0; });
+	for (uint32_t consumer = 0; consumer < CONSUMERS; consumer++) CHECK(queues.GetRemaining(consumer) == 100);
+
+	std::vector<int> popCounts(data.size(), 0);
+	size_t count;
+	bool stolen;
+	for (uint32_t consumer = CONSUMERS - 1; consumer > 0; consumer--)
+	{ // The other ranges are empty when a consumer is done with its own, so it steals from the late consumer 0
+		CHECK(PopOwnRange(queues, consumer, popCounts, data.data()) == 100);
+		const int* first = queues.Pop(consumer, count, 1, stolen);
+		CHECK(first && stolen && first - data.data() < 100);
+		for (size_t i = 0; i < count; i++) popCounts[first - data.data() + i]++;
+	}
+	const size_t lateOwn = PopOwnRange(queues, 0, popCounts, data.data());
+	CHECK(queues.Pop(0, count, 1, stolen) == nullptr);
+	for (int popCount : popCounts) CHECK(popCount == 1);
+	CHECK(lateOwn > 0 && lateOwn < 100);
+	// All the own ranges ran empty at the same time, the late consumer got less of its range done
+	for (uint32_t consumer = 0; consumer < CONSUMERS; consumer++) queues.Report(consumer, 1.0);
+
+	queues.Partition(data.data(), data.size(), [](size_t) { return 1.0; });
+	std::printf("The late consumer popped %zu of its 100 elements itself, its next range has %zu elements\n", lateOwn, queues.GetRemaining(0));
+	CHECK(queues.GetRemaining(0) < 100);
+	for (uint32_t consumer = 1; consumer < CONSUMERS; consumer++) CHECK(queues.GetRemaining(consumer) > 100);
+	return 0;
+}
+
+/**
+ * \brief A consumer that never reported gets the mean rate of the measured ones instead of disabling the feedback for everyone.
+ */
+static int TestUnmeasuredConsumerGetsMeanRate()
+{
+	std::vector<int> data(300, 1);
+	BalancedArrayQueues<int> queues;
+	queues.Init(3);
+	queues.Partition(data.data(), data.size(), [](size_t) { return 1.0; });
+	std::vector<int> popCounts(data.size(), 0);
+	PopOwnRange(queues, 0, popCounts, data.data());
+	PopOwnRange(queues, 1, popCounts, data.data());
+	queues.Report(0, 1.0); // 100 per second
+	queues.Report(1, 0.5); // 200 per second, consumer 2 never reports
+
+	queues.Partition(data.data(), data.size(), [](size_t) { return 1.0; });
+	const size_t range0 = queues.GetRemaining(0), range1 = queues.GetRemaining(1), range2 = queues.GetRemaining(2);
+	std::printf("Ranges with the rates 100, 200 and the mean of both: %zu %zu %zu\n", range0, range1, range2);
+	CHECK(range0 + range1 + range2 == data.size());
+	CHECK(range0 < range2 && range2 < range1); // The mean rate is 150
+	return 0;
+}
+
+int main()
+{
+	int failed = TestLateConsumerRangeShrinks();
+	failed += TestUnmeasuredConsumerGetsMeanRate();
+	return failed;
+}
@@ -0,0 +1,393 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "Context.hpp"
+#include "Scene/VulkanShader.hpp"
+#include "Resources/IShaderOwner.hpp"
+#include "../Scene/Scene.hpp"
+#include "../Base/ICloseable.hpp"
+#include "../Base/WorkerPool.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Vulkan
+	{
+		/**
+		 * \brief Culls the node/drawable pairs of a scene with a compute shader and draws the visible ones with one indirect draw per drawable.
+		 * The world matrices and bounds of all pairs are uploaded into a storage buffer every frame, the compute shader tests them against
+		 * the frustum and the depth hierarchy of the occluders and appends the visible ones to the instance list of their drawable.
+		 * The vertex shader reads the world matrix of an instance through the compacted list, so no per node descriptors are needed.
+		 * All buffers exist once per swapchain image, they can be rewritten as soon as the image has been acquired.
+		 */
+		class GpuCulling final : virtual public ICloseable, virtual public IShaderOwner
+		{
+			static constexpr uint32_t WORKGROUP_SIZE = 64; // Must match the local size of cull.comp
+			static constexpr uint32_t MIN_FILL_CHUNK_SIZE = 16;
+			static constexpr vk::DeviceSize MIN_BUFFER_SIZE = 4096;
+
+			/**
+			 * \brief The data of a node/drawable pair, laid out like the Instance struct of the shaders (std430).
+			 */
+			struct Instance
+			{
+				glm::mat4x4 world;
+				glm::vec4 center, extent; // The world bounds, w is unused
+				uint32_t drawIndex, visibleBase;
+				uint32_t potentiallyVisible; // 0 if the potentially visible set of the camera cell rejects the node
+				uint32_t padding;
+			};
+
+			struct CullConstants
+			{
+				glm::mat4x4 viewProjection;
+				uint32_t instanceCount, pyramidWidth, pyramidHeight, pyramidLevels;
+				glm::vec4 contributionOrigin; // Like Math::Frustum, w = 0 disables the contribution culling
+				glm::vec2 contributionDistance;
+				uint32_t padding[2];
+			};
+
+			struct HostBuffer
+			{
+				vk::Buffer buffer;
+				vk::DeviceMemory memory;
+				vk::DeviceSize size = 0;
+				void* mapped = nullptr;
+			};
+
+			struct FrameData
+			{
+				HostBuffer instances, draws, visible, pyramid;
+				vk::DescriptorSet descriptorSet;
+				CullConstants constants = {};
+			};
+
+			Context* context = nullptr;
+			vk::Device device;
+			vk::DescriptorSetLayout descriptorSetLayout;
+			vk::DescriptorPool descriptorPool;
+			vk::PipelineLayout cullLayout, drawLayout;
+			vk::ShaderModule cullModule;
+			vk::Pipeline cullPipeline;
+			VulkanShader drawShader;
+			Scene::Shader* shader = nullptr;
+			std::vector<FrameData> frames;
+			std::vector<Scene::Drawable*> drawables; // A drawable is added once for every level of detail that is used by one of its nodes
+			std::vector<Scene::Geometry*> meshes; // The mesh of the level of every entry of the drawables
+			std::vector<uint8_t> levels;
+			std::vector<uint32_t> visibleBases; // The first entry of every drawable in the visible list
+			std::vector<uint32_t> lodCounts;
+
+		public:
+			GpuCulling() = default;
+			~GpuCulling() { if (context) GpuCulling::Close(); }
+
+			/**
+			 * \param shader The shader of the scene, its vertex shader needs an "Indirect" variant (e.g. basicIndirect.vert)
+			 */
+			void Init(Context* context, Scene::Shader* shader)
+			{
+				this->context = context;
+				this->shader = shader;
+				device = context->device->device;
+				CreateLayouts();
+				cullModule = context->device->CreateShaderModule("Shader/cull.comp.spv");
+				const vk::ComputePipelineCreateInfo pipelineCreateInfo = { {}, { {}, vk::ShaderStageFlagBits::eCompute, cullModule, "main" }, cullLayout };
+				cullPipeline = device.createComputePipeline({}, pipelineCreateInfo);
+				drawShader.Init(context, shader, this, drawLayout, shader->vertexShaderName + "Indirect");
+				frames.resize(context->swapChain.GetImageCount());
+				vk::DescriptorPoolSize poolSize = { vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(4 * frames.size()) };
+				const vk::DescriptorPoolCreateInfo poolCreateInfo = { {}, static_cast<uint32_t>(frames.size()), 1, &poolSize };
+				descriptorPool = device.createDescriptorPool(poolCreateInfo);
+				for (FrameData& frame : frames)
+				{
+					const vk::DescriptorSetAllocateInfo descSetAllocInfo = { descriptorPool, 1, &descriptorSetLayout };
+					frame.descriptorSet = device.allocateDescriptorSets(descSetAllocInfo)[0];
+					Reserve(frame.instances, sizeof(Instance), true);
+					Reserve(frame.draws, sizeof(vk::DrawIndexedIndirectCommand), true);
+					Reserve(frame.visible, sizeof(uint32_t), false);
+					Reserve(frame.pyramid, sizeof(float), true);
+					UpdateDescriptorSet(frame);
+				}
+			}
+
+			/**
+			 * \brief Recreates the graphics pipeline, it has to be called when the swapchain has been resized.
+			 */
+			void Resize()
+			{
+				drawShader.Close();
+				drawShader.Init(context, shader, this, drawLayout, shader->vertexShaderName + "Indirect");
+			}
+
+			void Close() override
+			{
+				device.waitIdle();
+				for (FrameData& frame : frames)
+				{
+					for (HostBuffer* buffer : { &frame.instances, &frame.draws, &frame.visible, &frame.pyramid }) DestroyBuffer(*buffer);
+				}
+				frames.clear();
+				if (drawShader.shader) drawShader.Close();
+				device.destroyPipeline(cullPipeline);
+				device.destroyShaderModule(cullModule);
+				device.destroyPipelineLayout(cullLayout);
+				device.destroyPipelineLayout(drawLayout);
+				device.destroyDescriptorPool(descriptorPool);
+				device.destroyDescriptorSetLayout(descriptorSetLayout);
+				context = nullptr;
+			}
+
+			void RemoveShader(VulkanShader* shader) override
+			{} // The draw shader is owned by this object
+
+			/**
+			 * \brief Uploads the instances of all the drawables of the scene and the depth hierarchy of the occluders for a frame.
+			 * \param scene The scene to draw, its world matrices must be up to date
+			 * \param viewProjection The view projection matrix to cull against
+			 * \param frustum The frustum of the view projection matrix, only its contribution culling settings are used
+			 * \param occlusion The occlusion culler with the rasterized occluders of the frame, nullptr to only do frustum culling
+			 * \param lodSelector Optional selector for the levels of detail of the drawables, without one the mesh of the drawables is used
+			 * \param pvsCell Optional cell of a potentially visible set, the nodes that are not visible from it are skipped by the compute shader
+			 * \param frameId The id of the swapchain image, it must have been acquired already
+			 * \param pool Optional worker pool to fill the instances in parallel
+			 */
+			void Prepare(const Scene::Scene& scene, const glm::mat4x4& viewProjection, const Math::Frustum& frustum, const Scene::OcclusionCuller* occlusion,
+						 const Scene::LodSelector* lodSelector, const Scene::PvsCell& pvsCell, uint32_t frameId, WorkerPool* pool = nullptr)
+			{
+				FrameData& frame = frames[frameId];
+				if (lodSelector) SelectLods(scene.shapeList, *lodSelector, pool);
+				const uint32_t instanceCount = CollectDrawables(scene.shapeList, lodSelector != nullptr);
+				size_t pyramidSize = 0;
+				const size_t levelCount = occlusion ? occlusion->GetLevelCount() : 0;
+				for (size_t level = 0; level < levelCount; level++)
+				{
+					pyramidSize += static_cast<size_t>(occlusion->GetLevelWidth(level)) * occlusion->GetLevelHeight(level);
+				}
+				bool reallocated = Reserve(frame.instances, sizeof(Instance) * instanceCount, true);
+				reallocated |= Reserve(frame.draws, sizeof(vk::DrawIndexedIndirectCommand) * drawables.size(), true);
+				reallocated |= Reserve(frame.visible, sizeof(uint32_t) * instanceCount, false);
+				reallocated |= Reserve(frame.pyramid, sizeof(float) * pyramidSize, true);
+				if (reallocated) UpdateDescriptorSet(frame);
+
+				Instance* instances = static_cast<Instance*>(frame.instances.mapped);
+				vk::DrawIndexedIndirectCommand* draws = static_cast<vk::DrawIndexedIndirectCommand*>(frame.draws.mapped);
+				const auto fill = [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						const Scene::Drawable* drawable = drawables[i];
+						draws[i] = vk::DrawIndexedIndirectCommand(meshes[i]->GetIndexCount(), 0, 0, 0, 0); // The instance count is increased by the compute shader
+						Instance* instance = instances + visibleBases[i];
+						const bool filterLevel = lodSelector && !drawable->lods.empty();
+						for (size_t j = 0; j < drawable->nodes.size(); j++)
+						{
+							if (filterLevel && drawable->nodeLods[j] != levels[i]) continue;
+							const Scene::Node* node = drawable->nodes[j];
+							const Scene::TransformStorage* storage = node->GetTransformStorage();
+							const uint32_t index = node->GetTransformIndex();
+							instance->world = storage->GetWorldMatrices()[index];
+							instance->center = glm::vec4(storage->GetWorldBounds().GetCenter(index), 0);
+							instance->extent = glm::vec4(storage->GetWorldBounds().GetExtent(index), 0);
+							instance->drawIndex = static_cast<uint32_t>(i);
+							instance->visibleBase = visibleBases[i];
+							instance->potentiallyVisible = pvsCell.IsVisible(node->GetStableId()) ? 1 : 0;
+							instance++;
+						}
+					}
+				};
+				if (pool) pool->ParallelFor(drawables.size(), fill, MIN_FILL_CHUNK_SIZE);
+				else fill(0, drawables.size());
+
+				float* pyramid = static_cast<float*>(frame.pyramid.mapped);
+				for (size_t level = 0; level < levelCount; level++)
+				{
+					const size_t size = static_cast<size_t>(occlusion->GetLevelWidth(level)) * occlusion->GetLevelHeight(level);
+					std::memcpy(pyramid, occlusion->GetLevel(level), sizeof(float) * size);
+					pyramid += size;
+				}
+				frame.constants.viewProjection = viewProjection;
+				frame.constants.instanceCount = instanceCount;
+				frame.constants.pyramidWidth = occlusion ? occlusion->GetWidth() : 0;
+				frame.constants.pyramidHeight = occlusion ? occlusion->GetHeight() : 0;
+				frame.constants.pyramidLevels = static_cast<uint32_t>(levelCount);
+				frame.constants.contributionOrigin = frustum.GetContributionOrigin();
+				frame.constants.contributionDistance = frustum.GetContributionDistance();
+			}
+
+			/**
+			 * \brief Records the culling dispatch of a frame, must be recorded outside of the render pass that consumes the draw commands.
+			 */
+			void RecordCulling(vk::CommandBuffer& cmdBuffer, uint32_t frameId)
+			{
+				const FrameData& frame = frames[frameId];
+				if (!frame.constants.instanceCount) return;
+				cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+				cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+				cmdBuffer.pushConstants(cullLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants), &frame.constants);
+				cmdBuffer.dispatch((frame.constants.instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+				const vk::MemoryBarrier barrier = { vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead };
+				cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+										  {}, barrier, nullptr, nullptr);
+			}
+
+			/**
+			 * \brief Binds the graphics pipeline and the buffers of a frame, must be called before any RecordDraw of a command buffer.
+			 */
+			void RecordPipeline(vk::CommandBuffer& cmdBuffer, uint32_t frameId, const glm::mat4x4* viewProjection)
+			{
+				drawShader.Record(cmdBuffer, frameId);
+				cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, drawLayout, 0, 1, &frames[frameId].descriptorSet, 0, nullptr);
+				cmdBuffer.pushConstants(drawLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4x4), viewProjection);
+			}
+
+			/**
+			 * \brief Records the indirect draw of a drawable, its geometry must have been bound already.
+			 * \param drawIndex The index of the drawable in GetDrawables
+			 */
+			void RecordDraw(vk::CommandBuffer& cmdBuffer, uint32_t frameId, size_t drawIndex)
+			{
+				cmdBuffer.pushConstants(drawLayout, vk::ShaderStageFlagBits::eVertex, sizeof(glm::mat4x4), sizeof(uint32_t), &visibleBases[drawIndex]);
+				cmdBuffer.drawIndexedIndirect(frames[frameId].draws.buffer, drawIndex * sizeof(vk::DrawIndexedIndirectCommand), 1, sizeof(vk::DrawIndexedIndirectCommand));
+			}
+
+			/**
+			 * \brief Gets the drawables of the last Prepare, every one of them has to be drawn with RecordDraw.
+			 */
+			std::vector<Scene::Drawable*>& GetDrawables()
+			{
+				return drawables;
+			}
+
+			/**
+			 * \brief Gets the mesh that has to be bound for the RecordDraw of a drawable.
+			 */
+			Scene::Geometry* GetMesh(size_t drawIndex) const
+			{
+				return meshes[drawIndex];
+			}
+
+		private:
+			void SelectLods(const std::vector<Scene::Drawable*>& shapeList, const Scene::LodSelector& lodSelector, WorkerPool* pool)
+			{
+				const auto select = [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						Scene::Drawable* drawable = shapeList[i];
+						if (drawable->lods.empty()) continue;
+						for (size_t j = 0; j < drawable->nodes.size(); j++) lodSelector.Select(*drawable, j);
+					}
+				};
+				if (pool) pool->ParallelFor(shapeList.size(), select, MIN_FILL_CHUNK_SIZE);
+				else select(0, shapeList.size());
+			}
+
+			/**
+			 * \brief Creates one entry for every drawable and used level of detail.
+			 * \return The amount of instances of all entries
+			 */
+			uint32_t CollectDrawables(const std::vector<Scene::Drawable*>& shapeList, bool useLods)
+			{
+				drawables.clear();
+				meshes.clear();
+				levels.clear();
+				visibleBases.clear();
+				uint32_t instanceCount = 0;
+				const auto add = [&](Scene::Drawable* drawable, uint32_t level, uint32_t count)
+				{
+					drawables.push_back(drawable);
+					meshes.push_back(drawable->GetLodMesh(level));
+					levels.push_back(static_cast<uint8_t>(level));
+					visibleBases.push_back(instanceCount);
+					instanceCount += count;
+				};
+				for (Scene::Drawable* drawable : shapeList)
+				{
+					if (!drawable->mesh || drawable->nodes.empty()) continue;
+					if (!useLods || drawable->lods.empty())
+					{
+						add(drawable, 0, static_cast<uint32_t>(drawable->nodes.size()));
+						continue;
+					}
+					lodCounts.assign(drawable->lods.size() + 1, 0);
+					for (uint8_t level : drawable->nodeLods) lodCounts[level]++;
+					for (uint32_t level = 0; level < lodCounts.size(); level++)
+					{
+						if (lodCounts[level]) add(drawable, level, lodCounts[level]);
+					}
+				}
+				return instanceCount;
+			}
+
+			void CreateLayouts()
+			{
+				const vk::ShaderStageFlags computeAndVertex = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex;
+				std::array<vk::DescriptorSetLayoutBinding, 4> layoutBindings = { {
+					{ 0, vk::DescriptorType::eStorageBuffer, 1, computeAndVertex }, // Instances
+					{ 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute }, // Draw commands
+					{ 2, vk::DescriptorType::eStorageBuffer, 1, computeAndVertex }, // Visible instances
+					{ 3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute } // Depth hierarchy
+				} };
+				const vk::DescriptorSetLayoutCreateInfo dslci = { {}, static_cast<uint32_t>(layoutBindings.size()), layoutBindings.data() };
+				descriptorSetLayout = device.createDescriptorSetLayout(dslci);
+				const vk::PushConstantRange cullPushConstants = { vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants) };
+				cullLayout = device.createPipelineLayout({ {}, 1, &descriptorSetLayout, 1, &cullPushConstants });
+				// The view projection matrix and the first entry of the drawable in the visible list
+				const vk::PushConstantRange drawPushConstants = { vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4x4) + sizeof(uint32_t) };
+				drawLayout = device.createPipelineLayout({ {}, 1, &descriptorSetLayout, 1, &drawPushConstants });
+			}
+
+			/**
+			 * \brief Makes sure the buffer can hold the given amount of bytes. Every buffer has its own memory, so the host visible ones can stay mapped.
+			 * \return true if the buffer has been recreated
+			 */
+			bool Reserve(HostBuffer& buffer, vk::DeviceSize size, bool hostVisible)
+			{
+				if (size <= buffer.size) return false;
+				DestroyBuffer(buffer);
+				const vk::DeviceSize minSize = MIN_BUFFER_SIZE;
+				buffer.size = std::max(std::max(size, buffer.size * 2), minSize);
+				const vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+				buffer.buffer = device.createBuffer({ {}, buffer.size, usage, vk::SharingMode::eExclusive });
+				const vk::MemoryRequirements memoryRequirements = device.getBufferMemoryRequirements(buffer.buffer);
+				const vk::MemoryPropertyFlags properties = hostVisible ? vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent : vk::MemoryPropertyFlagBits::eDeviceLocal;
+				const vk::MemoryAllocateInfo allocInfo = { memoryRequirements.size, context->device->GetMemoryType(memoryRequirements.memoryTypeBits, properties) };
+				buffer.memory = device.allocateMemory(allocInfo);
+				device.bindBufferMemory(buffer.buffer, buffer.memory, 0);
+				if (hostVisible) buffer.mapped = device.mapMemory(buffer.memory, 0, VK_WHOLE_SIZE);
+				return true;
+			}
+
+			void DestroyBuffer(HostBuffer& buffer)
+			{
+				if (!buffer.buffer) return;
+				if (buffer.mapped) device.unmapMemory(buffer.memory);
+				device.destroyBuffer(buffer.buffer);
+				device.freeMemory(buffer.memory);
+				buffer.buffer = nullptr;
+				buffer.memory = nullptr;
+				buffer.mapped = nullptr;
+			}
+
+			void UpdateDescriptorSet(const FrameData& frame)
+			{
+				const std::array<vk::DescriptorBufferInfo, 4> bufferInfos = { {
+					{ frame.instances.buffer, 0, VK_WHOLE_SIZE },
+					{ frame.draws.buffer, 0, VK_WHOLE_SIZE },
+					{ frame.visible.buffer, 0, VK_WHOLE_SIZE },
+					{ frame.pyramid.buffer, 0, VK_WHOLE_SIZE }
+				} };
+				std::array<vk::WriteDescriptorSet, 4> writes;
+				for (uint32_t i = 0; i < writes.size(); i++)
+				{
+					writes[i] = { frame.descriptorSet, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfos[i] };
+				}
+				device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+			}
+		};
+	}
+}
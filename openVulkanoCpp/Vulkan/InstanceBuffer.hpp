@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "Context.hpp"
+#include "../Scene/DrawList.hpp"
+#include "../Base/ICloseable.hpp"
+#include "../Base/WorkerPool.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Vulkan
+	{
+		/**
+		 * \brief Holds the world matrices of all the nodes that are drawn in a frame.
+		 * The matrices are written into a storage buffer in the order of the draw list, so the nodes of an entry are a continuous range
+		 * of instances and the vertex shader reads its matrix with gl_InstanceIndex. The buffer exists once per swapchain image
+		 * and is bound once per command buffer with the descriptor set layout of the context pipeline.
+		 */
+		class InstanceBuffer final : virtual public ICloseable
+		{
+			static constexpr uint32_t MIN_FILL_CHUNK_SIZE = 256;
+			static constexpr vk::DeviceSize MIN_BUFFER_SIZE = 64 * sizeof(glm::mat4x4);
+
+			struct FrameData
+			{
+				vk::Buffer buffer;
+				vk::DeviceMemory memory;
+				vk::DeviceSize size = 0;
+				glm::mat4x4* mapped = nullptr;
+				vk::DescriptorSet descriptorSet;
+			};
+
+			Context* context = nullptr;
+			vk::Device device;
+			vk::DescriptorPool descriptorPool;
+			std::vector<FrameData> frames;
+
+		public:
+			InstanceBuffer() = default;
+			~InstanceBuffer() { if (context) InstanceBuffer::Close(); }
+
+			void Init(Context* context)
+			{
+				this->context = context;
+				device = context->device->device;
+				frames.resize(context->swapChain.GetImageCount());
+				vk::DescriptorPoolSize poolSize = { vk::DescriptorType::eStorageBuffer, static_cast<uint32_t>(frames.size()) };
+				descriptorPool = device.createDescriptorPool({ {}, static_cast<uint32_t>(frames.size()), 1, &poolSize });
+				for (FrameData& frame : frames)
+				{
+					frame.descriptorSet = device.allocateDescriptorSets({ descriptorPool, 1, &context->pipeline.descriptorSetLayout })[0];
+					Reserve(frame, 1);
+				}
+			}
+
+			void Close() override
+			{
+				device.waitIdle();
+				for (FrameData& frame : frames) DestroyBuffer(frame);
+				frames.clear();
+				device.destroyDescriptorPool(descriptorPool);
+				context = nullptr;
+			}
+
+			/**
+			 * \brief Writes the world matrices of all the nodes of a draw list into the buffer of a frame.
+			 * \param drawList The draw list that will be recorded, it must not change until the recording is done
+			 * \param frameId The id of the swapchain image, it must have been acquired already
+			 * \param pool Optional worker pool to copy the matrices in parallel
+			 */
+			void Prepare(const Scene::DrawList& drawList, uint32_t frameId, WorkerPool* pool = nullptr)
+			{
+				FrameData& frame = frames[frameId];
+				const std::vector<Scene::Node*>& nodes = drawList.GetNodes();
+				Reserve(frame, nodes.size());
+				const auto fill = [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						const Scene::Node* node = nodes[i];
+						frame.mapped[i] = node->GetTransformStorage()->GetWorldMatrices()[node->GetTransformIndex()];
+					}
+				};
+				if (pool) pool->ParallelFor(nodes.size(), fill, MIN_FILL_CHUNK_SIZE);
+				else fill(0, nodes.size());
+			}
+
+			/**
+			 * \brief Binds the buffer of a frame, the pipeline of a shader using the context pipeline layout must have been bound already.
+			 */
+			void Record(vk::CommandBuffer& cmdBuffer, uint32_t frameId)
+			{
+				cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, context->pipeline.pipelineLayout, 0, 1, &frames[frameId].descriptorSet, 0, nullptr);
+			}
+
+			/**
+			 * \brief Records the draws of a draw list entry, its geometry must have been bound already.
+			 * \param instanced Draws all the nodes of the entry with one instanced draw instead of one draw per node
+			 */
+			static void RecordDraw(vk::CommandBuffer& cmdBuffer, const Scene::DrawList& drawList, size_t drawIndex, bool instanced)
+			{
+				const uint32_t indexCount = drawList.GetMesh(drawIndex)->GetIndexCount();
+				const uint32_t firstNode = drawList.GetFirstNode(drawIndex), nodeCount = drawList.GetNodeCount(drawIndex);
+				if (instanced)
+				{
+					cmdBuffer.drawIndexed(indexCount, nodeCount, 0, 0, firstNode);
+					return;
+				}
+				for (uint32_t i = 0; i < nodeCount; i++)
+				{ // The instance index still selects the matrix of the node
+					cmdBuffer.drawIndexed(indexCount, 1, 0, 0, firstNode + i);
+				}
+			}
+
+		private:
+			/**
+			 * \brief Makes sure the buffer of a frame can hold the given amount of matrices. The buffer has its own memory, so it can stay mapped.
+			 */
+			void Reserve(FrameData& frame, size_t matrixCount)
+			{
+				const vk::DeviceSize size = matrixCount * sizeof(glm::mat4x4);
+				if (size <= frame.size) return;
+				DestroyBuffer(frame);
+				const vk::DeviceSize minSize = MIN_BUFFER_SIZE;
+				frame.size = std::max(std::max(size, frame.size * 2), minSize);
+				frame.buffer = device.createBuffer({ {}, frame.size, vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive });
+				const vk::MemoryRequirements memoryRequirements = device.getBufferMemoryRequirements(frame.buffer);
+				const vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+				frame.memory = device.allocateMemory({ memoryRequirements.size, context->device->GetMemoryType(memoryRequirements.memoryTypeBits, properties) });
+				device.bindBufferMemory(frame.buffer, frame.memory, 0);
+				frame.mapped = static_cast<glm::mat4x4*>(device.mapMemory(frame.memory, 0, VK_WHOLE_SIZE));
+				const vk::DescriptorBufferInfo bufferInfo = { frame.buffer, 0, VK_WHOLE_SIZE };
+				const vk::WriteDescriptorSet write = { frame.descriptorSet, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &bufferInfo };
+				device.updateDescriptorSets(1, &write, 0, nullptr);
+			}
+
+			void DestroyBuffer(FrameData& frame)
+			{
+				if (!frame.buffer) return;
+				device.unmapMemory(frame.memory);
+				device.destroyBuffer(frame.buffer);
+				device.freeMemory(frame.memory);
+				frame.buffer = nullptr;
+				frame.memory = nullptr;
+				frame.mapped = nullptr;
+			}
+		};
+	}
+}
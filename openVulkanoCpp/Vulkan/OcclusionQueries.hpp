@@ -0,0 +1,312 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <functional>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "Context.hpp"
+#include "CommandHelper.hpp"
+#include "../Scene/DrawList.hpp"
+#include "../Base/ICloseable.hpp"
+
+namespace openVulkanoCpp
+{
+	namespace Vulkan
+	{
+		struct OcclusionQueryStatistics
+		{
+			size_t testedPairs = 0; // The node/drawable pairs inside of the frustum whose mesh is expensive enough to be tested
+			size_t occludedPairs = 0; // The tested pairs that have not been drawn, because their last query found them hidden
+			size_t issuedQueries = 0;
+			size_t pendingResults = 0; // The queries whose results have not been available when they were read
+		};
+
+		/**
+		 * \brief Culls expensive node/drawable pairs with hardware occlusion queries of their world bounds, in the style of coherent hierarchical culling.
+		 * The results of a frame are read when its swapchain image gets used again, at that point its fence has been waited on,
+		 * so the cpu never waits for them. Pairs that have been visible are only queried every few frames,
+		 * pairs that have been hidden are queried every frame until they become visible again.
+		 * The boxes are drawn in a separate secondary command buffer after all the other ones, so they are tested against the whole frame.
+		 */
+		class OcclusionQueries final : virtual public ICloseable
+		{
+			static constexpr uint32_t VISIBLE_QUERY_INTERVAL = 4; // Visible pairs are only queried every few frames
+			static constexpr uint32_t PRUNE_INTERVAL = 256; // The state of pairs that have not been tested for this amount of frames is released
+			static constexpr uint32_t BOX_VERTEX_COUNT = 36; // Must match occlusionBox.vert
+
+			struct PairKey
+			{
+				const Scene::Node* node;
+				const Scene::Drawable* drawable;
+
+				bool operator==(const PairKey& other) const
+				{
+					return node == other.node && drawable == other.drawable;
+				}
+			};
+
+			struct PairKeyHash
+			{
+				size_t operator()(const PairKey& key) const
+				{
+					return std::hash<const void*>()(key.node) * 31 + std::hash<const void*>()(key.drawable);
+				}
+			};
+
+			struct PairState
+			{
+				uint64_t lastTestedFrame = 0;
+				bool visible = true;
+			};
+
+			struct BoxConstants
+			{
+				glm::mat4x4 viewProjection;
+				glm::vec4 center, extent;
+			};
+
+			struct FrameData
+			{
+				vk::QueryPool queryPool;
+				uint32_t capacity = 0;
+				std::vector<PairKey> queries; // The pair of every query that has been recorded for the frame
+				std::vector<BoxConstants> boxes;
+				CommandHelper commands;
+			};
+
+			Context* context = nullptr;
+			vk::Device device;
+			vk::PipelineLayout pipelineLayout;
+			vk::ShaderModule vertexModule;
+			vk::Pipeline pipeline;
+			uint32_t minIndexCount = 0;
+			uint64_t frameCounter = 1;
+			std::unordered_map<PairKey, PairState, PairKeyHash> states;
+			std::vector<FrameData> frames;
+			std::vector<uint64_t> results;
+			OcclusionQueryStatistics statistics;
+
+		public:
+			OcclusionQueries() = default;
+			~OcclusionQueries() { if (context) OcclusionQueries::Close(); }
+
+			/**
+			 * \param minIndexCount Only drawables whose mesh has at least this amount of indices are tested
+			 */
+			void Init(Context* context, uint32_t minIndexCount)
+			{
+				this->context = context;
+				this->minIndexCount = minIndexCount;
+				device = context->device->device;
+				const vk::PushConstantRange pushConstants = { vk::ShaderStageFlagBits::eVertex, 0, sizeof(BoxConstants) };
+				pipelineLayout = device.createPipelineLayout({ {}, 0, nullptr, 1, &pushConstants });
+				vertexModule = context->device->CreateShaderModule("Shader/occlusionBox.vert.spv");
+				CreatePipeline();
+				frames = std::vector<FrameData>(context->swapChain.GetImageCount());
+				for (FrameData& frame : frames)
+				{
+					frame.commands.Init(device, context->device->queueIndices.GetGraphics());
+				}
+			}
+
+			/**
+			 * \brief Recreates the pipeline, it has to be called when the swapchain has been resized.
+			 */
+			void Resize()
+			{
+				device.destroyPipeline(pipeline);
+				CreatePipeline();
+			}
+
+			void Close() override
+			{
+				device.waitIdle();
+				for (FrameData& frame : frames)
+				{
+					if (frame.queryPool) device.destroyQueryPool(frame.queryPool);
+					frame.commands.Close();
+					frame.commands.cmdPool = nullptr;
+				}
+				frames.clear();
+				states.clear();
+				device.destroyPipeline(pipeline);
+				device.destroyShaderModule(vertexModule);
+				device.destroyPipelineLayout(pipelineLayout);
+				context = nullptr;
+			}
+
+			/**
+			 * \brief Reads the results of the last use of the swapchain image, removes the pairs that have been hidden from the draw list
+			 * and prepares the queries of the frame. The image must have been acquired already.
+			 * \param drawList The frustum culled pairs of the frame
+			 * \param viewProjection The view projection matrix of the frame
+			 */
+			void Update(Scene::DrawList& drawList, const glm::mat4x4& viewProjection, uint32_t frameId)
+			{
+				FrameData& frame = frames[frameId];
+				statistics = OcclusionQueryStatistics();
+				ReadResults(frame);
+				frame.queries.clear();
+				frame.boxes.clear();
+				drawList.RemoveNodes([&](const Scene::Drawable* drawable, const Scene::Geometry* mesh, const Scene::Node* node)
+				{
+					if (mesh->GetIndexCount() < minIndexCount) return false;
+					statistics.testedPairs++;
+					const PairKey key = { node, drawable };
+					PairState& state = states[key];
+					// Pairs that have just entered the frustum are drawn, their old results are outdated
+					const bool visible = state.visible || state.lastTestedFrame + 1 < frameCounter;
+					state.lastTestedFrame = frameCounter;
+					BoxConstants box;
+					box.viewProjection = viewProjection;
+					const Math::BoundsArray& bounds = node->GetTransformStorage()->GetWorldBounds();
+					box.center = glm::vec4(bounds.GetCenter(node->GetTransformIndex()), 1);
+					box.extent = glm::vec4(bounds.GetExtent(node->GetTransformIndex()), 0);
+					if (CrossesNearPlane(box))
+					{ // Parts of the box would be clipped, so it can't be tested reliably
+						state.visible = true;
+						return false;
+					}
+					// The queries of the visible pairs are spread over the frames, so they don't all get queried in the same one
+					if (!visible || (PairKeyHash()(key) + frameCounter) % VISIBLE_QUERY_INTERVAL == 0)
+					{
+						frame.queries.push_back(key);
+						frame.boxes.push_back(box);
+					}
+					if (!visible) statistics.occludedPairs++;
+					return !visible;
+				});
+				statistics.issuedQueries = frame.queries.size();
+				if (frame.queries.size() > frame.capacity) CreateQueryPool(frame, static_cast<uint32_t>(frame.queries.size()));
+				if (frameCounter % PRUNE_INTERVAL == 0) Prune();
+				frameCounter++;
+			}
+
+			/**
+			 * \brief Resets the queries of a frame, must be recorded into the primary command buffer before the render pass begins.
+			 */
+			void RecordReset(vk::CommandBuffer& cmdBuffer, uint32_t frameId)
+			{
+				const FrameData& frame = frames[frameId];
+				if (!frame.queries.empty()) cmdBuffer.resetQueryPool(frame.queryPool, 0, static_cast<uint32_t>(frame.queries.size()));
+			}
+
+			/**
+			 * \brief Records the box queries of a frame into its secondary command buffer.
+			 * \param inheritance The render pass and frame buffer the command buffer will be executed in
+			 */
+			void Record(uint32_t frameId, const vk::CommandBufferInheritanceInfo& inheritance)
+			{
+				FrameData& frame = frames[frameId];
+				frame.commands.Reset();
+				vk::CommandBuffer& cmdBuffer = frame.commands.cmdBuffer;
+				cmdBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance });
+				if (!frame.queries.empty()) cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+				for (uint32_t i = 0; i < frame.boxes.size(); i++)
+				{
+					cmdBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(BoxConstants), &frame.boxes[i]);
+					cmdBuffer.beginQuery(frame.queryPool, i, {});
+					cmdBuffer.draw(BOX_VERTEX_COUNT, 1, 0, 0);
+					cmdBuffer.endQuery(frame.queryPool, i);
+				}
+				cmdBuffer.end();
+			}
+
+			/**
+			 * \brief Gets the command buffer with the queries of a frame, it must be executed after all other commands of the render pass.
+			 */
+			vk::CommandBuffer& GetCommandBuffer(uint32_t frameId)
+			{
+				return frames[frameId].commands.cmdBuffer;
+			}
+
+			/**
+			 * \brief Gets the statistics of the last Update.
+			 */
+			const OcclusionQueryStatistics& GetStatistics() const
+			{
+				return statistics;
+			}
+
+		private:
+			void CreatePipeline()
+			{
+				const vk::PipelineShaderStageCreateInfo shaderStage = { {}, vk::ShaderStageFlagBits::eVertex, vertexModule, "main" };
+				const vk::PipelineVertexInputStateCreateInfo vertexInput = {};
+				const vk::PipelineInputAssemblyStateCreateInfo inputAssembly = { {}, vk::PrimitiveTopology::eTriangleList, 0 };
+				auto viewport = context->swapChain.GetFullscreenViewport();
+				auto scissor = context->swapChain.GetFullscreenScissor();
+				const vk::PipelineViewportStateCreateInfo viewportState = { {}, 1, &viewport, 1, &scissor };
+				vk::PipelineRasterizationStateCreateInfo rasterizer = {};
+				rasterizer.cullMode = vk::CullModeFlagBits::eNone; // The camera may look at the inside of a box
+				rasterizer.lineWidth = 1;
+				const vk::PipelineMultisampleStateCreateInfo msaa = {};
+				// The same depth test as the scene shaders, but the boxes must not write into the depth buffer
+				const vk::PipelineDepthStencilStateCreateInfo depth = { {}, 1, 0, vk::CompareOp::eGreater };
+				const vk::PipelineColorBlendAttachmentState colorBlendAttachment = {}; // No color writes
+				vk::PipelineColorBlendStateCreateInfo colorInfo = {};
+				colorInfo.attachmentCount = 1;
+				colorInfo.pAttachments = &colorBlendAttachment;
+				const vk::GraphicsPipelineCreateInfo pipelineCreateInfo = { {}, 1, &shaderStage, &vertexInput, &inputAssembly, nullptr, &viewportState,
+					&rasterizer, &msaa, &depth, &colorInfo, nullptr, pipelineLayout, context->swapChainRenderPass.renderPass };
+				pipeline = device.createGraphicsPipeline({}, pipelineCreateInfo);
+			}
+
+			void CreateQueryPool(FrameData& frame, uint32_t capacity)
+			{
+				if (frame.queryPool) device.destroyQueryPool(frame.queryPool);
+				frame.capacity = std::max(capacity, frame.capacity * 2);
+				frame.queryPool = device.createQueryPool({ {}, vk::QueryType::eOcclusion, frame.capacity });
+			}
+
+			/**
+			 * \brief Reads the results of the queries that have been recorded the last time the frame has been used.
+			 */
+			void ReadResults(const FrameData& frame)
+			{
+				if (frame.queries.empty()) return;
+				const uint32_t count = static_cast<uint32_t>(frame.queries.size());
+				results.resize(2 * count);
+				// No wait flag, the fence of the frame has been waited on, so the results are normally available already
+				const vk::Result result = device.getQueryPoolResults(frame.queryPool, 0, count, results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+					vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+				if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) return;
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (!results[2 * i + 1])
+					{
+						statistics.pendingResults++;
+						continue;
+					}
+					const auto state = states.find(frame.queries[i]);
+					if (state != states.end()) state->second.visible = results[2 * i] > 0;
+				}
+			}
+
+			static bool CrossesNearPlane(const BoxConstants& box)
+			{
+				const glm::vec4 base = box.viewProjection * box.center;
+				const glm::vec4 axisX = box.viewProjection[0] * box.extent.x, axisY = box.viewProjection[1] * box.extent.y, axisZ = box.viewProjection[2] * box.extent.z;
+				for (int i = 0; i < 8; i++)
+				{
+					const glm::vec4 corner = base + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+					if (corner.z < 0 || corner.w <= 0) return true;
+				}
+				return false;
+			}
+
+			/**
+			 * \brief Releases the state of the pairs that have not been tested for a while, e.g. because their nodes have been removed.
+			 */
+			void Prune()
+			{
+				for (auto it = states.begin(); it != states.end();)
+				{
+					if (it->second.lastTestedFrame + PRUNE_INTERVAL < frameCounter) it = states.erase(it);
+					else ++it;
+				}
+			}
+		};
+	}
+}
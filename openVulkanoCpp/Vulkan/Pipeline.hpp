@@ -30,7 +30,8 @@ namespace openVulkanoCpp
 			void CreatePipelineLayout()
 			{
 				vk::PushConstantRange camPushConstantDesc = { vk::ShaderStageFlagBits::eVertex, 0, 64 };
-				vk::DescriptorSetLayoutBinding nodeLayoutBinding = { 0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eVertex };
+				// The world matrices of all the drawn nodes, see InstanceBuffer
+				vk::DescriptorSetLayoutBinding nodeLayoutBinding = { 0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex };
 				std::array<vk::DescriptorSetLayoutBinding, 1> layoutBindings = { nodeLayoutBinding };
 				vk::DescriptorSetLayoutCreateInfo dslci = { {}, layoutBindings.size(), layoutBindings.data() };
 				descriptorSetLayout = device.createDescriptorSetLayout(dslci);
@@ -2,14 +2,19 @@
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <chrono>
 #include "../Base/Render/IRenderer.hpp"
 #include "../Base/UI/IWindow.hpp"
 #include "../Base/Logger.hpp"
 #include "Context.hpp"
 #include "Resources/ResourceManager.hpp"
-#include "../Data/ReadOnlyAtomicArrayQueue.hpp"
+#include "../Data/BalancedArrayQueues.hpp"
 #include "CommandHelper.hpp"
 #include "../Base/EngineConfiguration.hpp"
+#include "../Base/WorkerPool.hpp"
+#include "GpuCulling.hpp"
+#include "OcclusionQueries.hpp"
+#include "InstanceBuffer.hpp"
 
 namespace openVulkanoCpp
 {
@@ -22,6 +27,10 @@ namespace openVulkanoCpp
 
 		class Renderer : public IRenderer
 		{
+			static constexpr size_t MIN_RECORD_CHUNK_SIZE = 4;
+			// Estimated recording costs, relative to one draw call
+			static constexpr double DRAW_COST = 1, BIND_COST = 2, PREPARE_COST = 200, PREPARE_COST_PER_INDEX = 0.01;
+
 			Context context;
 			std::shared_ptr<spdlog::logger> logger;
 			std::vector<WaitSemaphores> waitSemaphores;
@@ -29,10 +38,19 @@ namespace openVulkanoCpp
 			std::ofstream perfFile;
 			ResourceManager resourceManager;
 			uint32_t currentImageId = -1;
-			std::vector<std::thread> threadPool;
+			WorkerPool workers; // Updates the transforms, culls and records the secondary buffers, worker i always records with command pool i
 			std::vector<std::vector<CommandHelper>> commands;
 			std::vector<std::vector<vk::CommandBuffer>> submitBuffers;
+			Data::BalancedArrayQueues<Scene::Drawable*> recordQueues; // One range of the draw list per command pool
+			std::chrono::high_resolution_clock::time_point recordStart;
 			VulkanShader* shader;
+			Scene::DrawList drawList;
+			GpuCulling gpuCulling;
+			bool useGpuCulling = false;
+			OcclusionQueries occlusionQueries;
+			bool useOcclusionQueries = false;
+			InstanceBuffer instanceBuffer;
+			bool useInstancing = false;
 
 		public:
 			Renderer() = default;
@@ -56,10 +74,11 @@ namespace openVulkanoCpp
 					waitSemaphores[i].renderReady.resize(2);
 				}
 				resourceManager.Init(&context, context.swapChain.GetImageCount());
-				threadPool.resize(EngineConfiguration::GetEngineConfiguration()->GetNumThreads() - 1);
+				workers.Init(EngineConfiguration::GetEngineConfiguration()->GetNumThreads() - 1, EngineConfiguration::GetEngineConfiguration()->IsWorkerThreadPinningEnabled());
 
 				//Setup cmd pools and buffers
-				commands.resize(threadPool.size() + 2); // One extra cmd object for the primary buffer and one for the main thread
+				commands.resize(workers.GetThreadCount() + 1); // One cmd object per worker, one for the main thread and one for the primary buffer
+				recordQueues.Init(workers.GetThreadCount());
 				for(uint32_t i = 0; i < commands.size(); i++)
 				{
 					commands[i] = std::vector<CommandHelper>(context.swapChain.GetImageCount());
@@ -80,6 +99,13 @@ namespace openVulkanoCpp
 				}
 
 				shader = resourceManager.CreateShader(scene->shader);
+				useGpuCulling = EngineConfiguration::GetEngineConfiguration()->IsGpuCullingEnabled();
+				if (useGpuCulling) gpuCulling.Init(&context, scene->shader);
+				const uint32_t occlusionQueryMinIndexCount = EngineConfiguration::GetEngineConfiguration()->GetOcclusionQueryMinIndexCount();
+				useOcclusionQueries = !useGpuCulling && occlusionQueryMinIndexCount > 0;
+				if (useOcclusionQueries) occlusionQueries.Init(&context, occlusionQueryMinIndexCount);
+				useInstancing = EngineConfiguration::GetEngineConfiguration()->IsInstancingEnabled();
+				if (!useGpuCulling) instanceBuffer.Init(&context);
 
 				perfFile.open("perf.csv");
 				perfFile << "sep=,\ntotal,fps\n";
@@ -103,6 +129,10 @@ namespace openVulkanoCpp
 			void Close() override
 			{
 				perfFile.close();
+				if (useGpuCulling) gpuCulling.Close();
+				if (useOcclusionQueries) occlusionQueries.Close();
+				if (!useGpuCulling) instanceBuffer.Close();
+				workers.Close();
 				//context.Close();
 			}
 
@@ -115,11 +145,15 @@ namespace openVulkanoCpp
 			{
 				context.Resize(newWidth, newHeight);
 				resourceManager.Resize();
+				if (useGpuCulling) gpuCulling.Resize();
+				if (useOcclusionQueries) occlusionQueries.Resize();
 			}
 
 			void SetScene(Scene::Scene* scene) override
 			{
+				if (this->scene) this->scene->GetJournal().SetEnabled(false);
 				this->scene = scene;
+				if (scene) scene->GetJournal().SetEnabled(true);
 			}
 
 			Scene::Scene* GetScene() override
@@ -132,17 +166,13 @@ namespace openVulkanoCpp
 				return &commands[poolId][currentImageId];
 			}
 
-			static void RunThread(Renderer* renderer, Data::ReadOnlyAtomicArrayQueue<Scene::Drawable*>* jobQueue, uint32_t id)
-			{
-				renderer->RecordSecondaryBuffer(jobQueue, id);
-			}
-
-			void StartThreads(Data::ReadOnlyAtomicArrayQueue<Scene::Drawable*>* jobQueue)
+			/**
+			 * \brief Starts the recording of the secondary buffers on the persistent workers, the main thread joins in after recording the primary buffer.
+			 */
+			void StartThreads()
 			{
-				for(uint32_t i = 0; i < threadPool.size(); i++)
-				{
-					threadPool[i] = std::thread(RunThread, this, jobQueue, i);
-				}
+				recordStart = std::chrono::high_resolution_clock::now();
+				workers.Start([this](uint32_t id) { RecordSecondaryBuffer(id); });
 			}
 
 			void RecordPrimaryBuffer()
@@ -150,14 +180,18 @@ namespace openVulkanoCpp
 				CommandHelper* cmdHelper = GetCommandData(commands.size() - 1);
 				cmdHelper->Reset();
 				cmdHelper->cmdBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+				if (useGpuCulling) gpuCulling.RecordCulling(cmdHelper->cmdBuffer, currentImageId);
+				if (useOcclusionQueries) occlusionQueries.RecordReset(cmdHelper->cmdBuffer, currentImageId);
 				context.swapChainRenderPass.Begin(cmdHelper->cmdBuffer);
 			}
 
 			void Submit()
 			{
-				for (auto& thread : threadPool) { thread.join(); } // Wait till everything is recorded
+				workers.Wait(); // Wait till everything is recorded
 				CommandHelper* cmdHelper = GetCommandData(commands.size() - 1);
 				cmdHelper->cmdBuffer.executeCommands(submitBuffers[currentImageId].size(), submitBuffers[currentImageId].data());
+				// The occlusion queries have to be tested against everything else that has been drawn
+				if (useOcclusionQueries) cmdHelper->cmdBuffer.executeCommands(1, &occlusionQueries.GetCommandBuffer(currentImageId));
 				context.swapChainRenderPass.End(cmdHelper->cmdBuffer);
 				cmdHelper->cmdBuffer.end();
 				std::array<vk::PipelineStageFlags, 2> stateFlags = { vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput), vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput) };
@@ -174,46 +208,125 @@ namespace openVulkanoCpp
 			void Render()
 			{
 				resourceManager.StartFrame(currentImageId);
-				Data::ReadOnlyAtomicArrayQueue<Scene::Drawable*> jobQueue(scene->shapeList);
-				StartThreads(&jobQueue);
+				scene->UpdateWorldMatrices(&workers);
+				ApplySceneChanges();
+				const glm::mat4x4& viewProjection = scene->GetCamera()->GetViewProjectionMatrix();
+				scene->SetViewportHeight(static_cast<float>(context.swapChain.GetSize().height)); // Used by the contribution culling
+				if (useGpuCulling)
+				{ // Only the occluders are rasterized on the cpu, everything else is culled by the compute shader
+					const Scene::LodSelector lodSelector(*scene->GetCamera(), scene->GetLodHysteresis());
+					gpuCulling.Prepare(*scene, viewProjection, scene->CreateFrustum(viewProjection), scene->RenderOccluders(viewProjection, &workers), &lodSelector, scene->GetPvsCell(), currentImageId, &workers);
+				}
+				else
+				{
+					scene->Cull(viewProjection, drawList, &workers);
+					if (useOcclusionQueries) occlusionQueries.Update(drawList, viewProjection, currentImageId);
+					instanceBuffer.Prepare(drawList, currentImageId, &workers);
+				}
+				PartitionRecording();
+				StartThreads();
 				RecordPrimaryBuffer();
-				RecordSecondaryBuffer(&jobQueue, threadPool.size());
+				RecordSecondaryBuffer(workers.GetThreadCount() - 1);
+				if (useOcclusionQueries) occlusionQueries.Record(currentImageId, GetInheritanceInfo());
 				Submit();
 			}
 
-			void RecordSecondaryBuffer(Data::ReadOnlyAtomicArrayQueue<Scene::Drawable*>* jobQueue, uint32_t poolId)
+			/**
+			 * \brief Gets the statistics of the occlusion queries of the last frame, all zero if they are disabled.
+			 */
+			const OcclusionQueryStatistics& GetOcclusionQueryStatistics() const
+			{
+				return occlusionQueries.GetStatistics();
+			}
+
+			vk::CommandBufferInheritanceInfo GetInheritanceInfo()
+			{
+				return { context.swapChainRenderPass.renderPass, 0, context.swapChainRenderPass.GetFrameBuffer()->GetCurrentFrameBuffer() };
+			}
+
+			/**
+			 * \brief Consumes the journal of the scene. The geometries of new drawables are uploaded before the recording starts,
+			 * the nodes need no render resources, their world matrices are written into the instance buffer every frame.
+			 */
+			void ApplySceneChanges()
+			{
+				Scene::SceneJournal& journal = scene->GetJournal();
+				if (journal.IsEmpty()) return;
+				for (Scene::Drawable* drawable : journal.GetAddedDrawables())
+				{
+					if (drawable->mesh && !drawable->mesh->renderGeo) resourceManager.PrepareGeometry(drawable->mesh);
+					for (const Scene::LodLevel& lod : drawable->lods)
+					{
+						if (!lod.mesh->renderGeo) resourceManager.PrepareGeometry(lod.mesh);
+					}
+				}
+				journal.Clear();
+			}
+
+			/**
+			 * \brief Splits the draw list between the recording threads by the estimated recording cost of its entries.
+			 * The cost grows with the draw calls (one per node without instancing), the geometry binds and geometries that still need to be uploaded.
+			 * The index count only matters for the upload, the recording of a draw doesn't depend on it.
+			 */
+			void PartitionRecording()
+			{
+				std::vector<Scene::Drawable*>& drawables = useGpuCulling ? gpuCulling.GetDrawables() : drawList.GetDrawables();
+				recordQueues.Partition(drawables.data(), drawables.size(), [this](size_t drawIndex)
+				{
+					Scene::Geometry* mesh = useGpuCulling ? gpuCulling.GetMesh(drawIndex) : drawList.GetMesh(drawIndex);
+					double cost = (useGpuCulling || useInstancing) ? DRAW_COST : DRAW_COST * drawList.GetNodeCount(drawIndex);
+					if (drawIndex == 0 || mesh != (useGpuCulling ? gpuCulling.GetMesh(drawIndex - 1) : drawList.GetMesh(drawIndex - 1))) cost += BIND_COST;
+					if (!mesh->renderGeo) cost += PREPARE_COST + PREPARE_COST_PER_INDEX * mesh->GetIndexCount();
+					return cost;
+				});
+			}
+
+			void RecordSecondaryBuffer(uint32_t poolId)
 			{
 				Scene::Geometry* lastGeo = nullptr;
-				Scene::Node* lastNode = nullptr;
 				CommandHelper* cmdHelper = GetCommandData(poolId);
 				cmdHelper->Reset();
-				vk::CommandBufferInheritanceInfo inheritance = { context.swapChainRenderPass.renderPass, 0, context.swapChainRenderPass.GetFrameBuffer()->GetCurrentFrameBuffer() };
+				const vk::CommandBufferInheritanceInfo inheritance = GetInheritanceInfo();
 				cmdHelper->cmdBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance });
-				shader->Record(cmdHelper->cmdBuffer, currentImageId);
-				cmdHelper->cmdBuffer.pushConstants(context.pipeline.pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, 64, scene->GetCamera()->GetViewProjectionMatrixPointer());
+				if (useGpuCulling) gpuCulling.RecordPipeline(cmdHelper->cmdBuffer, currentImageId, scene->GetCamera()->GetViewProjectionMatrixPointer());
+				else
+				{
+					shader->Record(cmdHelper->cmdBuffer, currentImageId);
+					instanceBuffer.Record(cmdHelper->cmdBuffer, currentImageId);
+					cmdHelper->cmdBuffer.pushConstants(context.pipeline.pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, 64, scene->GetCamera()->GetViewProjectionMatrixPointer());
+				}
+				Scene::Drawable* const* drawables = useGpuCulling ? gpuCulling.GetDrawables().data() : drawList.GetDrawables().data();
 				Scene::Drawable** drawablePointer;
-				while((drawablePointer = jobQueue->Pop()) != nullptr)
+				size_t drawCount;
+				// Measured from the common start, so the main thread gets less work for the time it spends on the primary buffer
+				const auto getRecordTime = [this]() { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - recordStart).count(); };
+				double ownRangeTime = 0;
+				bool stolen;
+				// Continuous chunks of the sorted draw list keep the geometry binds of neighbouring entries redundant
+				while((drawablePointer = recordQueues.Pop(poolId, drawCount, MIN_RECORD_CHUNK_SIZE, stolen)) != nullptr)
 				{
-					Scene::Drawable* drawable = *drawablePointer;
-					Scene::Geometry* mesh = drawable->mesh;
-					if (mesh != lastGeo)
+					if (stolen && ownRangeTime == 0) ownRangeTime = getRecordTime();
+					const size_t firstIndex = drawablePointer - drawables;
+					for (size_t drawIndex = firstIndex; drawIndex < firstIndex + drawCount; drawIndex++)
 					{
-						if (!mesh->renderGeo) resourceManager.PrepareGeometry(mesh);
-						dynamic_cast<VulkanGeometry*>(mesh->renderGeo)->Record(cmdHelper->cmdBuffer, currentImageId);
-						lastGeo = mesh;
-					}
-					for(Scene::Node* node : drawable->nodes)
-					{
-						if (node != lastNode)
+						Scene::Geometry* mesh = useGpuCulling ? gpuCulling.GetMesh(drawIndex) : drawList.GetMesh(drawIndex);
+						if (mesh != lastGeo)
+						{
+							if (!mesh->renderGeo) resourceManager.PrepareGeometry(mesh);
+							dynamic_cast<VulkanGeometry*>(mesh->renderGeo)->Record(cmdHelper->cmdBuffer, currentImageId);
+							lastGeo = mesh;
+						}
+						if (useGpuCulling)
 						{
-							if (!node->renderNode) resourceManager.PrepareNode(node);
-							dynamic_cast<VulkanNode*>(node->renderNode)->Record(cmdHelper->cmdBuffer, currentImageId);
-							lastNode = node;
+							gpuCulling.RecordDraw(cmdHelper->cmdBuffer, currentImageId, drawIndex);
+							continue;
 						}
-						cmdHelper->cmdBuffer.drawIndexed(mesh->GetIndexCount(), 1, 0, 0, 0);
+						InstanceBuffer::RecordDraw(cmdHelper->cmdBuffer, drawList, drawIndex, useInstancing);
 					}
 				}
+				if (ownRangeTime == 0) ownRangeTime = getRecordTime();
 				cmdHelper->cmdBuffer.end();
+				recordQueues.Report(poolId, ownRangeTime);
 			}
 		};
 	}
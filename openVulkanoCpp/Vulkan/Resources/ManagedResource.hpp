@@ -64,7 +64,7 @@ namespace openVulkanoCpp
 				mapped = nullptr;
 			}
 
-			void Copy(void* data) const
+			void Copy(const void* data) const
 			{
 				if(mapped)
 				{
@@ -78,7 +78,7 @@ namespace openVulkanoCpp
 				}
 			}
 
-			void Copy(void* data, uint32_t size, uint32_t offset) const
+			void Copy(const void* data, uint32_t size, uint32_t offset) const
 			{
 				if(mapped) memcpy(static_cast<char*>(mapped) + offset, data, size);
 				else
@@ -6,7 +6,6 @@
 #include "IShaderOwner.hpp"
 #include "../Scene/VulkanGeometry.hpp"
 #include "ManagedResource.hpp"
-#include "../Scene/VulkanNode.hpp"
 
 namespace openVulkanoCpp
 {
@@ -123,34 +122,6 @@ namespace openVulkanoCpp
 				mutex.unlock();
 			}
 
-			void PrepareNode(Scene::Node* node)
-			{
-				mutex.lock();
-				if (!node->renderNode)
-				{
-					UniformBuffer* uBuffer = new UniformBuffer();
-					ManagedBuffer* buffer;
-					VulkanNode* vkNode;
-					const vk::DeviceSize allocSize = aligned(sizeof(glm::mat4x4), uniformBufferAlignment);
-					if (node->GetUpdateFrequency() != Scene::UpdateFrequency::Never)
-					{
-						vkNode = new VulkanNodeDynamic();
-						uint32_t imgs = context->swapChain.GetImageCount();
-						buffer = CreateBuffer(imgs * allocSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible);
-						buffer->Map();
-					}
-					else
-					{
-						vkNode = new VulkanNode();
-						buffer = CreateDeviceOnlyBufferWithData(sizeof(glm::mat4), vk::BufferUsageFlagBits::eUniformBuffer, &node->worldMat);
-					}
-					uBuffer->Init(buffer, allocSize, &context->pipeline.descriptorSetLayout, context->pipeline.pipelineLayout);
-					vkNode->Init(node, uBuffer);
-					node->renderNode = vkNode;
-				}
-				mutex.unlock();
-			}
-
 			void RemoveShader(VulkanShader* shader) override
 			{
 				Utils::Remove(shaders, shader);
@@ -189,7 +160,7 @@ namespace openVulkanoCpp
 				toFree[currentBuffer].clear();
 			}
 
-			ManagedBuffer* CreateDeviceOnlyBufferWithData(vk::DeviceSize size, vk::BufferUsageFlagBits usage, void* data)
+			ManagedBuffer* CreateDeviceOnlyBufferWithData(vk::DeviceSize size, vk::BufferUsageFlagBits usage, const void* data)
 			{
 				ManagedBuffer* target = CreateBuffer(size, usage | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
 				ManagedBuffer* uploadBuffer = CreateBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible);
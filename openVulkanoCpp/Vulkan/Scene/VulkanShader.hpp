@@ -35,11 +35,21 @@ namespace openVulkanoCpp
 			virtual ~VulkanShader() { if (shader) VulkanShader::Close(); }
 
 			void Init(Context* context, Scene::Shader* shader, IShaderOwner* owner)
+			{
+				Init(context, shader, owner, context->pipeline.pipelineLayout, shader->vertexShaderName);
+			}
+
+			/**
+			 * \brief Creates the pipeline with a different layout and vertex shader, e.g. for the gpu driven rendering.
+			 * \param layout The pipeline layout the vertex shader has been written for
+			 * \param vertexShaderName The name of the vertex shader without the ".vert.spv" extension
+			 */
+			void Init(Context* context, Scene::Shader* shader, IShaderOwner* owner, vk::PipelineLayout layout, const std::string& vertexShaderName)
 			{
 				this->device = context->device->device;
 				this->shader = shader;
 				this->owner = owner;
-				shaderModuleVertex = context->device->CreateShaderModule(shader->vertexShaderName + ".vert.spv");
+				shaderModuleVertex = context->device->CreateShaderModule(vertexShaderName + ".vert.spv");
 				shaderModuleFragment = context->device->CreateShaderModule(shader->fragmentShaderName + ".frag.spv");
 				std::vector<vk::PipelineShaderStageCreateInfo> shaderStageCreateInfos(2);
 				shaderStageCreateInfos[0] = { {}, vk::ShaderStageFlagBits::eVertex, shaderModuleVertex, "main" };
@@ -73,7 +83,7 @@ namespace openVulkanoCpp
 				
 				
 				vk::GraphicsPipelineCreateInfo pipelineCreateInfo = { {}, static_cast<uint32_t>(shaderStageCreateInfos.size()), shaderStageCreateInfos.data(), &pipelineVertexInputStateCreateInfo, &inputAssembly,
-				nullptr, &viewportStateCreateInfo, &rasterizer, &msaa, &depth, &colorInfo, nullptr, context->pipeline.pipelineLayout, context->swapChainRenderPass.renderPass };
+				nullptr, &viewportStateCreateInfo, &rasterizer, &msaa, &depth, &colorInfo, nullptr, layout, context->swapChainRenderPass.renderPass };
 				pipeline = this->device.createGraphicsPipeline({}, pipelineCreateInfo);
 				
 			}
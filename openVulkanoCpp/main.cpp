@@ -1,5 +1,6 @@
 #include "Host/GraphicsAppManager.hpp"
 #include "Scene/Scene.hpp"
+#include "Scene/SceneBuilder.hpp"
 #include "Scene/Shader.hpp"
 #include "Base/EngineConfiguration.hpp"
 
@@ -15,6 +16,7 @@ class ExampleApp : public openVulkanoCpp::IGraphicsApp
 	Shader shader;
 	std::vector<Drawable*> drawablesPool;
 	std::vector<Node*> nodesPool;
+	std::vector<glm::vec3> dynamicPositions;
 
 public:
 	std::string GetAppName() override { return "ExampleApp"; }
@@ -29,24 +31,24 @@ public:
 		scene.SetCamera(&cam);
 		cam.SetMatrix(glm::translate(glm::mat4(1), glm::vec3(0,0,-10)));
 		shader.Init("Shader/basic", "Shader/basic");
+		SceneBuilder builder(&scene);
+		builder.Reserve(OBJECTS, GEOS, GEOS);
 		drawablesPool.resize(GEOS);
 		for(int i = 0; i < GEOS; i++)
 		{
-			Geometry* geo = new Geometry();
+			Geometry* geo = scene.CreateGeometry();
 			geo->InitCube(std::rand() % 1000 / 1000.0f + 0.01f, std::rand() % 1000 / 1000.0f + 0.01f, std::rand() % 1000 / 1000.0f + 0.01f, glm::vec4((std::rand() % 255) / 255.0f, (std::rand() % 255) / 255.0f, (std::rand() % 255) / 255.0f, 1));
-			drawablesPool[i] = new Drawable();
+			drawablesPool[i] = scene.CreateDrawable();
 			drawablesPool[i]->Init(geo, &mat);
 		}
-		nodesPool.resize(OBJECTS);
+		std::vector<NodeDescription> descriptions(OBJECTS);
 		for(int i = 0; i < OBJECTS; i++)
 		{
-			nodesPool[i] = new Node();
-			nodesPool[i]->Init();
-			scene.GetRoot()->AddChild(nodesPool[i]);
-			if (i < DYNAMIC) nodesPool[i]->SetUpdateFrequency(UpdateFrequency::Always);
-			nodesPool[i]->AddDrawable(drawablesPool[std::rand() % GEOS]);
-			nodesPool[i]->SetMatrix(glm::translate(glm::mat4x4(1), glm::vec3((std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5)));
+			if (i < DYNAMIC) descriptions[i].updateFrequency = UpdateFrequency::Always;
+			descriptions[i].drawable = drawablesPool[std::rand() % GEOS];
+			descriptions[i].matrix = glm::translate(glm::mat4x4(1), glm::vec3((std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5));
 		}
+		nodesPool = builder.Build(descriptions.data(), OBJECTS);
 		
 		scene.shader = &shader;
 
@@ -55,10 +57,12 @@ public:
 
 	void Tick() override
 	{
+		dynamicPositions.resize(DYNAMIC);
 		for(int i = 0; i < DYNAMIC; i++)
 		{
-			nodesPool[i]->SetMatrix(glm::translate(glm::mat4x4(1), glm::vec3((std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5)));
+			dynamicPositions[i] = glm::vec3((std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5, (std::rand() % 10000) / 1000.0f - 5);
 		}
+		scene.SetPositions(nodesPool.data(), dynamicPositions.data(), DYNAMIC);
 	}
 
 	void Close() override{}